@@ -0,0 +1,291 @@
+#pragma once
+
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Fixed workload run (--benchmark): once the scene is loaded, a few warm-up frames are
+// rendered, then a given number of measured frames, each with its own fixed camera placement
+// and scene time. Frame times are measured present to present on the CPU (headless windows
+// throttle on frames in flight as a swap chain does) and pass times come from the GPU
+// profiler. Results are written as JSON and can be compared with the file
+// of an earlier run.
+class Benchmark
+{
+public:
+    enum class Phase { Loading, Warmup, Measuring, Done };
+
+    // Scene time step of a measured frame, in seconds
+    static constexpr double frameStep {1.0 / 60.0};
+
+    Benchmark(GpuProfiler &gpuProfiler, const unsigned int &frames, const unsigned int &warmupFrames = 10) :
+        gpuProfiler(gpuProfiler), frames(std::max(frames, 1u)), warmupFrames(warmupFrames) {}
+
+    Phase getPhase() { return phase; }
+    bool isDone() { return phase == Phase::Done; }
+
+    // Where the camera should be this frame along its path, from 0 to 1
+    float getPathPosition()
+    {
+        if (phase != Phase::Measuring || frames == 1) return 0.0f;
+        return frameTimes.size() / float(frames - 1);
+    }
+
+    // Scene time of this frame, independent of how fast frames are rendered
+    double getSceneTime() { return phase == Phase::Measuring ? frameTimes.size() * frameStep : 0.0; }
+
+    // Reported in load order
+    void addLoadTime(const std::string &name, const double &ms) { loadTimes.push_back({name, ms}); }
+    // Rendering options to tell runs apart, e.g. the render scale. Not compared.
+    void addSetting(const std::string &name, const std::string &value) { settings.push_back({name, value}); }
+
+    // Call once per frame, right after presenting it
+    void endFrame(const bool &sceneReady)
+    {
+        auto now = std::chrono::steady_clock::now();
+        switch (phase) {
+            case Phase::Loading:
+                if (sceneReady) phase = warmupFrames > 0 ? Phase::Warmup : Phase::Measuring;
+                break;
+            case Phase::Warmup:
+                if (++warmedUp >= warmupFrames) phase = Phase::Measuring;
+                break;
+            case Phase::Measuring:
+                frameTimes.push_back(std::chrono::duration<double, std::milli>(now - lastFrame).count());
+                if (frameTimes.size() == frames) phase = Phase::Done;
+                break;
+            case Phase::Done:
+                break;
+        }
+        // Nothing before the first measured frame is kept, GPU frames in flight included
+        if (phase == Phase::Measuring && frameTimes.empty()) gpuProfiler.reset();
+        lastFrame = now;
+    }
+
+    bool writeJson(const std::string &path, const std::string &model, const std::string &environment,
+                   const unsigned int &width, const unsigned int &height)
+    {
+        std::ofstream file(path);
+        if (!file) {
+            std::cout << "ERROR::BENCHMARK::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+        gpuProfiler.flush();
+
+        std::vector<double> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        double total {0.0};
+        for (double value : sorted) total += value;
+
+        file << std::fixed << std::setprecision(4) << "{\n"
+             << "  \"model\": \"" << escape(model) << "\",\n"
+             << "  \"environment\": \"" << escape(environment) << "\",\n"
+             << "  \"renderer\": \"" << escape((const char *)glGetString(GL_RENDERER)) << "\",\n"
+             << "  \"width\": " << width << ",\n"
+             << "  \"height\": " << height << ",\n"
+             << "  \"frames\": " << frameTimes.size() << ",\n"
+             << "  \"warmupFrames\": " << warmupFrames << ",\n";
+        for (const std::pair<std::string, std::string> &setting : settings)
+            file << "  \"" << escape(setting.first) << "\": \"" << escape(setting.second) << "\",\n";
+        file << "  \"frameTimeMs\": {";
+        if (!sorted.empty())
+            file << "\"mean\": " << total / sorted.size() << ", \"p50\": " << percentile(sorted, 0.50)
+                 << ", \"p95\": " << percentile(sorted, 0.95) << ", \"p99\": " << percentile(sorted, 0.99)
+                 << ", \"min\": " << sorted.front() << ", \"max\": " << sorted.back();
+        file << "},\n  \"gpuPassesMs\": {";
+
+        // Nested scopes are named after their parents, e.g. "SSAO/Blur"
+        std::vector<std::string> parents;
+        bool first {true};
+        for (const GpuProfiler::Summary &summary : gpuProfiler.getSummaries()) {
+            parents.resize(summary.depth);
+            std::string name;
+            for (const std::string &parent : parents) name += parent + "/";
+            name += summary.name;
+            parents.push_back(summary.name);
+            file << (first ? "\n" : ",\n") << "    \"" << escape(name) << "\": {\"mean\": " << summary.average
+                 << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+                 << ", \"samples\": " << summary.samples << "}";
+            first = false;
+        }
+        file << "\n  },\n  \"gpuDroppedFrames\": " << gpuProfiler.getDroppedFrames() << ",\n  \"loadMs\": {";
+        first = true;
+        for (const std::pair<std::string, double> &load : loadTimes) {
+            file << (first ? "" : ", ") << "\"" << escape(load.first) << "\": " << load.second;
+            first = false;
+        }
+        file << "}\n}\n";
+
+        if (!sorted.empty())
+            std::cout << "Benchmark: " << sorted.size() << " frames, mean " << total / sorted.size() << " ms, p50 "
+                      << percentile(sorted, 0.50) << " ms, p95 " << percentile(sorted, 0.95) << " ms, p99 "
+                      << percentile(sorted, 0.99) << " ms, written to " << path << std::endl;
+        return true;
+    }
+
+    // Compares the timings of two result files and lists every metric that got slower by
+    // more than thresholdPercent. Returns false on regression or if a file cannot be read.
+    static bool compare(const std::string &currentPath, const std::string &baselinePath, const double &thresholdPercent)
+    {
+        std::map<std::string, double> current, baseline;
+        if (!readJson(currentPath, current) || !readJson(baselinePath, baseline)) return false;
+
+        unsigned int regressions {0};
+        std::cout << std::left << std::setw(36) << "Metric (ms)" << std::right << std::setw(11) << "baseline"
+                  << std::setw(11) << "current" << std::setw(10) << "change" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        for (const std::pair<const std::string, double> &metric : current) {
+            // Only timings: counts and sizes are not better when lower
+            if (!isTiming(metric.first)) continue;
+            auto it = baseline.find(metric.first);
+            if (it == baseline.end()) continue;
+            double change = it->second > 0.0 ? 100.0 * (metric.second - it->second) / it->second : 0.0;
+            bool regressed = change > thresholdPercent;
+            regressions += regressed;
+            std::cout << std::left << std::setw(36) << metric.first << std::right << std::setw(11) << it->second
+                      << std::setw(11) << metric.second << std::setw(9) << std::showpos << change << std::noshowpos
+                      << "%" << (regressed ? "  REGRESSION" : "") << std::endl;
+        }
+        std::cout << std::defaultfloat;
+        for (const char *setting : {"width", "height", "frames"}) {
+            auto currentIt = current.find(setting), baselineIt = baseline.find(setting);
+            // Missing in either file counts as a difference
+            if (currentIt == current.end() || baselineIt == baseline.end() || currentIt->second != baselineIt->second)
+                std::cout << "WARNING::BENCHMARK::DIFFERENT_SETTINGS " << setting << " differs from the baseline"
+                          << std::endl;
+        }
+        std::cout << regressions << " regression(s) above " << thresholdPercent << "% against " << baselinePath
+                  << std::endl;
+        return regressions == 0;
+    }
+
+private:
+    GpuProfiler &gpuProfiler;
+    unsigned int frames, warmupFrames;
+    unsigned int warmedUp {0};
+    Phase phase {Phase::Loading};
+    std::vector<double> frameTimes;
+    std::chrono::steady_clock::time_point lastFrame;
+    std::vector<std::pair<std::string, double>> loadTimes;
+    std::vector<std::pair<std::string, std::string>> settings;
+
+    static double percentile(const std::vector<double> &sorted, const double &fraction)
+    {
+        size_t index = std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5));
+        return sorted[index];
+    }
+
+    static bool isTiming(const std::string &key)
+    {
+        for (const char *prefix : {"frameTimeMs.", "gpuPassesMs.", "loadMs."})
+            if (key.compare(0, std::strlen(prefix), prefix) == 0)
+                return key.size() < 8 || key.compare(key.size() - 8, 8, ".samples") != 0;
+        return false;
+    }
+
+    static std::string escape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    // Reads the numbers of a result file, keyed by their dotted path (e.g. "frameTimeMs.p95").
+    // Just enough JSON for the files written above: strings are skipped, arrays are not expected.
+    static bool readJson(const std::string &path, std::map<std::string, double> &values)
+    {
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "ERROR::BENCHMARK::CANNOT_READ " << path << std::endl;
+            return false;
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string text = stream.str();
+        size_t pos {0};
+        if (!parseValue(text, pos, "", values)) {
+            std::cout << "ERROR::BENCHMARK::INVALID_JSON " << path << " at offset " << pos << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static void skipSpaces(const std::string &text, size_t &pos)
+    {
+        while (pos < text.size() && std::isspace((unsigned char)text[pos])) pos++;
+    }
+
+    static bool parseString(const std::string &text, size_t &pos, std::string &result)
+    {
+        if (pos >= text.size() || text[pos] != '"') return false;
+        result.clear();
+        for (pos++; pos < text.size() && text[pos] != '"'; pos++) {
+            if (text[pos] == '\\') pos++;
+            if (pos < text.size()) result += text[pos];
+        }
+        if (pos >= text.size()) return false;
+        pos++;
+        return true;
+    }
+
+    static bool parseValue(const std::string &text, size_t &pos, const std::string &key,
+                           std::map<std::string, double> &values)
+    {
+        skipSpaces(text, pos);
+        if (pos >= text.size()) return false;
+        if (text[pos] == '"') {
+            std::string ignored;
+            return parseString(text, pos, ignored);
+        }
+        if (text[pos] != '{') {
+            size_t end = pos;
+            while (end < text.size() && (std::isdigit((unsigned char)text[end]) || std::strchr("+-.eE", text[end])))
+                end++;
+            if (end == pos) return false;
+            values[key] = std::atof(text.substr(pos, end - pos).c_str());
+            pos = end;
+            return true;
+        }
+
+        pos++;
+        skipSpaces(text, pos);
+        if (pos < text.size() && text[pos] == '}') {
+            pos++;
+            return true;
+        }
+        while (pos < text.size()) {
+            skipSpaces(text, pos);
+            std::string name;
+            if (!parseString(text, pos, name)) return false;
+            skipSpaces(text, pos);
+            if (pos >= text.size() || text[pos++] != ':') return false;
+            if (!parseValue(text, pos, key.empty() ? name : key + "." + name, values)) return false;
+            skipSpaces(text, pos);
+            if (pos < text.size() && text[pos] == ',') {
+                pos++;
+                continue;
+            }
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Vertex.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+// Large vertex and index buffers shared by every mesh of one vertex format, with a single VAO.
+// Meshes get sub-ranges of both buffers and draw with glDrawElementsBaseVertex, so that a whole
+// model is drawn without rebinding any buffer. Released ranges go back to a free list where
+// neighbours are merged, so loading and unloading models does not fragment the buffers forever.
+// All methods must be called from the thread owning the GL context.
+class BufferPool
+{
+public:
+    struct Allocation {
+        // Byte offsets in the vertex and index buffers
+        size_t vertexOffset {0}, vertexBytes {0};
+        size_t indexOffset {0}, indexBytes {0};
+        // First vertex of the range, to be passed as base vertex
+        int baseVertex {0};
+    };
+
+    // Pool shared by all models using this vertex format. Lives as long as the process.
+    static BufferPool &shared(const VertexFormat &format)
+    {
+        static BufferPool fullPool(VertexFormat::Full), compactPool(VertexFormat::Compact);
+        return format == VertexFormat::Compact ? compactPool : fullPool;
+    }
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    VertexFormat getVertexFormat() { return vertexFormat; }
+
+    // Copy vertexCount vertices and indexBytes worth of indices into the pool, growing it if needed
+    Allocation allocate(const void *vertices, const size_t &vertexCount, const void *indices, const size_t &indexBytes)
+    {
+        if (VAO == 0) init();
+
+        Allocation allocation;
+        allocation.vertexBytes = vertexCount * vertexSize(vertexFormat);
+        allocation.indexBytes = indexBytes;
+        // Vertex ranges are aligned on whole vertices to get an integral base vertex,
+        // index ranges on 4 bytes so that 16 and 32-bit indices can share the buffer
+        allocation.vertexOffset = vertexArena.allocate(allocation.vertexBytes, vertexSize(vertexFormat));
+        allocation.indexOffset = indexArena.allocate(allocation.indexBytes, sizeof(unsigned int));
+        allocation.baseVertex = allocation.vertexOffset / vertexSize(vertexFormat);
+        if (vertexArena.capacity != vertexCapacity || indexArena.capacity != indexCapacity)
+            setupVertexArray();
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexArena.buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, allocation.vertexOffset, allocation.vertexBytes, vertices);
+        // The element array binding is VAO state
+        GLState::bindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexArena.buffer);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, allocation.indexOffset, allocation.indexBytes, indices);
+        GLState::bindVertexArray(0);
+        return allocation;
+    }
+
+    void release(const Allocation &allocation)
+    {
+        vertexArena.release(allocation.vertexOffset, allocation.vertexBytes);
+        indexArena.release(allocation.indexOffset, allocation.indexBytes);
+    }
+
+    void bind() const { GLState::bindVertexArray(VAO); }
+
+    void printStats()
+    {
+        std::cout << "Buffer pool (" << (vertexFormat == VertexFormat::Compact ? "compact" : "full") << " vertices): "
+                  << vertexArena.used << " / " << vertexArena.capacity << " vertex bytes in "
+                  << vertexArena.freeBlocks.size() << " free block(s), "
+                  << indexArena.used << " / " << indexArena.capacity << " index bytes in "
+                  << indexArena.freeBlocks.size() << " free block(s)" << std::endl;
+    }
+
+private:
+    // One GL buffer with a first-fit free list
+    struct Arena {
+        unsigned int buffer {0};
+        size_t capacity {0}, used {0};
+        // Free ranges by offset, never adjacent to each other
+        std::map<size_t, size_t> freeBlocks;
+
+        size_t allocate(const size_t &bytes, const size_t &alignment)
+        {
+            for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+                size_t offset = (it->first + alignment - 1) / alignment * alignment;
+                size_t padding = offset - it->first;
+                if (it->second < padding + bytes) continue;
+
+                size_t blockOffset = it->first, blockSize = it->second;
+                freeBlocks.erase(it);
+                if (padding > 0) freeBlocks[blockOffset] = padding;
+                if (blockSize > padding + bytes) freeBlocks[offset + bytes] = blockSize - padding - bytes;
+                used += bytes;
+                return offset;
+            }
+            grow(capacity + bytes + alignment);
+            return allocate(bytes, alignment);
+        }
+
+        void release(const size_t &offset, const size_t &bytes)
+        {
+            if (bytes == 0) return;
+            used -= bytes;
+            addFreeBlock(offset, bytes);
+        }
+
+        void addFreeBlock(const size_t &offset, const size_t &bytes)
+        {
+            auto it = freeBlocks.emplace(offset, bytes).first;
+            // Merge with the following then the preceding free block
+            auto next = std::next(it);
+            if (next != freeBlocks.end() && it->first + it->second == next->first) {
+                it->second += next->second;
+                freeBlocks.erase(next);
+            }
+            if (it != freeBlocks.begin()) {
+                auto previous = std::prev(it);
+                if (previous->first + previous->second == it->first) {
+                    previous->second += it->second;
+                    freeBlocks.erase(it);
+                }
+            }
+        }
+
+        // Reallocate with at least minCapacity bytes, keeping the current content
+        void grow(const size_t &minCapacity)
+        {
+            size_t newCapacity = std::max(minCapacity, 2 * capacity);
+            unsigned int newBuffer;
+            glGenBuffers(1, &newBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, NULL, GL_STATIC_DRAW);
+            if (buffer != 0) {
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity);
+                glDeleteBuffers(1, &buffer);
+            }
+            addFreeBlock(capacity, newCapacity - capacity);
+            buffer = newBuffer;
+            capacity = newCapacity;
+        }
+    };
+
+    VertexFormat vertexFormat;
+    unsigned int VAO {0};
+    Arena vertexArena, indexArena;
+    // Capacities the VAO was set up with
+    size_t vertexCapacity {0}, indexCapacity {0};
+
+    static constexpr size_t initialVertexBytes {16 << 20}, initialIndexBytes {8 << 20};
+
+    explicit BufferPool(const VertexFormat &format) : vertexFormat(format) {}
+
+    void init()
+    {
+        glGenVertexArrays(1, &VAO);
+        vertexArena.grow(initialVertexBytes);
+        indexArena.grow(initialIndexBytes);
+        setupVertexArray();
+    }
+
+    // Buffers are replaced when growing, so attributes have to be pointed at the new ones
+    void setupVertexArray()
+    {
+        GLState::bindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexArena.buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexArena.buffer);
+        setupVertexAttributes(vertexFormat);
+        GLState::bindVertexArray(0);
+        vertexCapacity = vertexArena.capacity;
+        indexCapacity = indexArena.capacity;
+    }
+};
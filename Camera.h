@@ -3,7 +3,6 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include "Shader.h"
 
 class Camera 
 {
@@ -19,9 +18,8 @@ private:
     float speed {2.5f};
     float sensibility {0.05f};
 
-    std::string camPosStr        {"cameraPos" },
-                viewMatStr       {"view"      },
-                projectionMatStr {"projection"};
+    // Set whenever the view or projection changes, see FrameData::update()
+    bool dirty {true};
 
 public:
 
@@ -34,17 +32,23 @@ public:
         pos += (speed * dz) * front; 
         // Left-right movements
         pos += (speed * dx) * glm::normalize(glm::cross(front, up));
+        dirty = true;
     }
 
     void rotateFromInput(const float &dx, const float &dy)
     {
         yaw   += dx * sensibility;
         pitch -= dy * sensibility;
+        updateFront();
+    }
 
-        // Convert euler angles to a direction vector for the camera
-        float pitchRad = glm::radians(pitch), yawRad = glm::radians(yaw);
-        glm::vec3 direction(cos(yawRad) * cos(pitchRad), sin(pitchRad), sin(yawRad) * cos(pitchRad));
-        front = glm::normalize(direction);
+    // Absolute placement, e.g. to replay a recorded path (angles in degrees)
+    void setView(const glm::vec3 &position, const float &yawDegrees, const float &pitchDegrees)
+    {
+        pos = position;
+        yaw = yawDegrees;
+        pitch = pitchDegrees;
+        updateFront();
     }
 
     void zoomFromScroll(const float &d)
@@ -54,24 +58,36 @@ public:
             fov = 1.0f;
         else if (fov > 45.0f)
             fov = 45.0f;
+        dirty = true;
     } 
 
-    void writeToShader(Shader &shader, const unsigned int &widthPx, const unsigned int &heightPx)
+    // True once after each change of the camera
+    bool consumeChanges()
     {
-        shader.setVec3(camPosStr, pos);
-        shader.setMatrix4f(viewMatStr, getViewMatrix());
-        shader.setMatrix4f(projectionMatStr, getProjMatrix(widthPx, heightPx));
+        bool changed = dirty;
+        dirty = false;
+        return changed;
     }
 
     glm::vec3 getPosition() { return pos; }
+    float getYaw() { return yaw; }
+    float getPitch() { return pitch; }
     glm::mat4 getViewMatrix() { return glm::lookAt(pos, pos + front, up); }
 
-private:
-
     glm::mat4 getProjMatrix(const int &widthPx, const int &heightPx) 
     { 
         return glm::perspective(glm::radians(fov), 
                         widthPx / (float)heightPx, 
                         zNear, zFar);
     }
+
+private:
+    // Convert euler angles to a direction vector for the camera
+    void updateFront()
+    {
+        float pitchRad = glm::radians(pitch), yawRad = glm::radians(yaw);
+        glm::vec3 direction(cos(yawRad) * cos(pitchRad), sin(pitchRad), sin(yawRad) * cos(pitchRad));
+        front = glm::normalize(direction);
+        dirty = true;
+    }
 };
\ No newline at end of file
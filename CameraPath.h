@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Camera.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Camera placements to replay, so that two runs render exactly the same frames. Keyframes
+// are linearly interpolated; files hold one "x y z yaw pitch" keyframe per line (degrees).
+class CameraPath
+{
+public:
+    struct Keyframe {
+        glm::vec3 position {0.0f};
+        float yaw {-90.0f}, pitch {0.0f};
+    };
+
+    // One turn around the box, slightly above it and looking at its center
+    static CameraPath orbit(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                            const unsigned int &keyframeCount = 64)
+    {
+        glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+        glm::vec3 extent = boundsMax - boundsMin;
+        float radius = std::max(0.75f * glm::length(extent), 0.5f);
+        float height = 0.25f * extent.y;
+        float pitch = -glm::degrees(std::atan2(height, radius));
+
+        CameraPath path;
+        for (unsigned int i = 0; i <= keyframeCount; i++) {
+            float angle = glm::two_pi<float>() * i / keyframeCount;
+            Keyframe keyframe;
+            keyframe.position = center + glm::vec3(radius * std::cos(angle), height, radius * std::sin(angle));
+            // Facing the center, without wrapping around so that interpolation stays continuous
+            keyframe.yaw = glm::degrees(angle) + 180.0f;
+            keyframe.pitch = pitch;
+            path.keyframes.push_back(keyframe);
+        }
+        return path;
+    }
+
+    bool load(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "ERROR::CAMERA_PATH::CANNOT_READ " << path << std::endl;
+            return false;
+        }
+        keyframes.clear();
+        Keyframe keyframe;
+        while (file >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.yaw >> keyframe.pitch)
+            keyframes.push_back(keyframe);
+        if (keyframes.empty()) {
+            std::cout << "ERROR::CAMERA_PATH::NO_KEYFRAME " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool save(const std::string &path) const
+    {
+        std::ofstream file(path);
+        if (!file) {
+            std::cout << "ERROR::CAMERA_PATH::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+        for (const Keyframe &keyframe : keyframes)
+            file << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " "
+                 << keyframe.yaw << " " << keyframe.pitch << "\n";
+        return true;
+    }
+
+    // Appends the current placement of the camera, e.g. once per frame while flying around
+    void record(Camera &camera) { keyframes.push_back({camera.getPosition(), camera.getYaw(), camera.getPitch()}); }
+
+    bool empty() const { return keyframes.empty(); }
+    size_t size() const { return keyframes.size(); }
+
+    // Places the camera at position t of the path, from 0 (first keyframe) to 1 (last one)
+    void apply(const float &t, Camera &camera) const
+    {
+        if (keyframes.empty()) return;
+        float position = std::min(std::max(t, 0.0f), 1.0f) * (keyframes.size() - 1);
+        size_t index = std::min((size_t)position, keyframes.size() - 1);
+        const Keyframe &from = keyframes[index];
+        const Keyframe &to = keyframes[std::min(index + 1, keyframes.size() - 1)];
+        float blend = position - index;
+        camera.setView(glm::mix(from.position, to.position, blend), glm::mix(from.yaw, to.yaw, blend),
+                       glm::mix(from.pitch, to.pitch, blend));
+    }
+
+private:
+    std::vector<Keyframe> keyframes;
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped CPU timing zones, exported as Chrome trace events (chrome://tracing, Perfetto).
+// Zones are compiled in only when building with -DCPU_PROFILER (make CXXFLAGS=-DCPU_PROFILER);
+// otherwise the macros below expand to nothing. Each thread appends to its own buffer, so
+// recording takes no lock: a zone costs two clock reads and one store. Buffers are rings of
+// fixed capacity: once full, each event overwrites the oldest one, so that a trace always
+// covers the end of a long session.
+//     CPU_PROFILE_THREAD("Main");
+//     { CPU_PROFILE_SCOPE("Geometry pass"); ... }
+#ifdef CPU_PROFILER
+#define CPU_PROFILE_CONCAT_IMPL(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_IMPL(a, b)
+// The name must be a string literal: only its address is stored
+#define CPU_PROFILE_SCOPE(name) CpuProfiler::Zone CPU_PROFILE_CONCAT(cpuProfileZone, __LINE__)("" name)
+#define CPU_PROFILE_THREAD(name) CpuProfiler::setThreadName(name)
+#else
+#define CPU_PROFILE_SCOPE(name)
+#define CPU_PROFILE_THREAD(name)
+#endif
+
+class CpuProfiler
+{
+public:
+#ifdef CPU_PROFILER
+    static constexpr bool enabled {true};
+#else
+    static constexpr bool enabled {false};
+#endif
+
+    // Events kept per thread, about 1.5 MB each
+    static constexpr size_t eventsPerThread {1 << 16};
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char *name) : name(name), start(nowNs()) {}
+        ~Zone() { record(name, start, nowNs() - start); }
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        const char *name;
+        uint64_t start;
+    };
+
+    // Nanoseconds since the first call in the process
+    static uint64_t nowNs()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    static void record(const char *name, const uint64_t &startNs, const uint64_t &durationNs)
+    {
+        ThreadBuffer &buffer = threadBuffer();
+        // Only this thread writes count, the number of events ever recorded: the exporter reads
+        // the last eventsPerThread ones
+        size_t count = buffer.count.load(std::memory_order_relaxed);
+        buffer.events[count % eventsPerThread] = {name, startNs, durationNs};
+        buffer.count.store(count + 1, std::memory_order_release);
+    }
+
+    // Label of the calling thread in the trace
+    static void setThreadName(const std::string &name)
+    {
+        ThreadBuffer &buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(registryMutex());
+        buffer.name = name;
+    }
+
+    // Last events recorded so far by every thread, including threads that have exited since.
+    // Threads still recording may overwrite the oldest events while they are written: export
+    // once the other threads are idle, e.g. on exit.
+    static bool writeChromeTrace(const std::string &path)
+    {
+        std::ofstream file(path);
+        if (!file) {
+            std::cout << "ERROR::CPU_PROFILER::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(registryMutex());
+        size_t written {0}, overwritten {0};
+        file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first {true};
+        for (const std::shared_ptr<ThreadBuffer> &buffer : registry()) {
+            file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                 << ",\"args\":{\"name\":\"" << escape(buffer->name) << "\"}}";
+            first = false;
+            size_t count = buffer->count.load(std::memory_order_acquire);
+            size_t oldest = count > eventsPerThread ? count - eventsPerThread : 0;
+            // Oldest first, so that events stay in recording order
+            for (size_t i = oldest; i < count; i++) {
+                const Event &event = buffer->events[i % eventsPerThread];
+                // Trace timestamps are in microseconds
+                file << ",\n{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                     << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << event.durationNs / 1000.0 << "}";
+            }
+            written += count - oldest;
+            overwritten += oldest;
+        }
+        file << "\n]}\n";
+        std::cout << "CPU trace: " << written << " events from " << registry().size() << " thread(s) written to "
+                  << path << ", " << overwritten << " older ones overwritten" << std::endl;
+        return true;
+    }
+
+private:
+    struct Event {
+        const char *name;
+        uint64_t startNs, durationNs;
+    };
+
+    struct ThreadBuffer {
+        unsigned int id {0};
+        std::string name;
+        std::unique_ptr<Event[]> events {new Event[eventsPerThread]};
+        std::atomic<size_t> count {0};
+    };
+
+    static std::mutex &registryMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Buffers are shared with the registry so that they outlive their thread
+    static std::vector<std::shared_ptr<ThreadBuffer>> &registry()
+    {
+        static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        return buffers;
+    }
+
+    // Registered on the first event of each thread, the only time a lock is taken
+    static ThreadBuffer &threadBuffer()
+    {
+        thread_local ThreadBuffer *buffer {nullptr};
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            std::shared_ptr<ThreadBuffer> created = std::make_shared<ThreadBuffer>();
+            created->id = registry().size() + 1;
+            created->name = "Thread " + std::to_string(created->id);
+            registry().push_back(created);
+            buffer = created.get();
+        }
+        return *buffer;
+    }
+
+    static std::string escape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "GpuProfiler.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Optional depth-only pre-pass of the geometry pass: once the depth buffer holds the nearest
+// surfaces, the G-buffer pass runs with GL_EQUAL and depth writes off, so each pixel writes
+// its attachments only once. Overdraw is measured on pre-pass frames with GL_SAMPLES_PASSED
+// queries (core since 1.5): the depth-only draws count every fragment passing the depth test
+// in draw order, that is what the G-buffer pass would shade without pre-pass, and the
+// G-buffer pass counts each covered pixel once. Like GpuProfiler, results are read back
+// GpuProfiler::frameLatency frames later and dropped when not available yet.
+// In Auto mode, the pre-pass is kept while the overdraw is above enableOverdraw, dropped
+// under disableOverdraw, and otherwise rendered every probeInterval frames to keep the
+// measure up to date. Query objects live as long as the GL context.
+// Usage, once per frame around the geometry pass:
+//     if (prepass.beginFrame(sceneReady)) {
+//         prepass.beginDepth(); ...depth-only draws...; prepass.beginShading();
+//     }
+//     ...G-buffer draws...
+//     prepass.endFrame();
+class DepthPrepass
+{
+public:
+    enum class Mode { Off, On, Auto };
+
+    // Saving MRT writes only pays for the second vertex pass above some overdraw
+    static constexpr double enableOverdraw {1.5}, disableOverdraw {1.3};
+    static constexpr unsigned int probeInterval {120};
+
+    explicit DepthPrepass(const Mode &mode) : mode(mode), frames(GpuProfiler::frameLatency) {}
+
+    DepthPrepass(const DepthPrepass &) = delete;
+    DepthPrepass &operator=(const DepthPrepass &) = delete;
+
+    static Mode parseMode(const std::string &name)
+    {
+        if (name == "on") return Mode::On;
+        if (name == "auto") return Mode::Auto;
+        return Mode::Off;
+    }
+
+    static std::string modeName(const Mode &mode)
+    {
+        return mode == Mode::On ? "on" : mode == Mode::Auto ? "auto" : "off";
+    }
+
+    // Collects the oldest frame in flight, then tells whether this frame has a pre-pass.
+    // Frames without scene (e.g. while the model loads) never have one.
+    bool beginFrame(const bool &sceneReady)
+    {
+        Frame &frame = frames[frameIndex % GpuProfiler::frameLatency];
+        if (frame.measured) collect(frame);
+        frame.measured = false;
+
+        active = false;
+        if (sceneReady && mode == Mode::On) active = true;
+        else if (sceneReady && mode == Mode::Auto) active = enabled || ++framesSinceProbe >= probeInterval;
+        if (active) framesSinceProbe = 0;
+        return active;
+    }
+
+    // Around the depth-only draws, then the G-buffer draws, on pre-pass frames only
+    void beginDepth()
+    {
+        Frame &frame = frames[frameIndex % GpuProfiler::frameLatency];
+        if (frame.queries[0] == 0) glGenQueries(2, frame.queries);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glBeginQuery(GL_SAMPLES_PASSED, frame.queries[0]);
+    }
+
+    void beginShading()
+    {
+        Frame &frame = frames[frameIndex % GpuProfiler::frameLatency];
+        glEndQuery(GL_SAMPLES_PASSED);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        glBeginQuery(GL_SAMPLES_PASSED, frame.queries[1]);
+        frame.measured = true;
+    }
+
+    // Restores the default depth state (GL_LEQUAL, writes on)
+    void endFrame()
+    {
+        if (active) {
+            glEndQuery(GL_SAMPLES_PASSED);
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_TRUE);
+        }
+        frameIndex++;
+    }
+
+    Mode getMode() { return mode; }
+    // Whether the last frame had a pre-pass
+    bool isActive() { return active; }
+    // Fragments passing the depth test per covered pixel, 0 before the first measure
+    double getOverdraw() { return overdraw; }
+    // Of the last measure
+    uint64_t getCoveredPixels() { return coveredPixels; }
+    uint64_t getDroppedFrames() { return droppedFrames; }
+
+private:
+    struct Frame {
+        // Depth-only then G-buffer samples passed
+        unsigned int queries[2] {0, 0};
+        bool measured {false};
+    };
+
+    Mode mode;
+    std::vector<Frame> frames;
+    uint64_t frameIndex {0}, droppedFrames {0};
+    bool active {false};
+    // Auto mode decision, and frames since the last pre-pass
+    bool enabled {false};
+    unsigned int framesSinceProbe {probeInterval};
+
+    double overdraw {0.0};
+    uint64_t coveredPixels {0};
+
+    void collect(const Frame &frame)
+    {
+        int available {0};
+        glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            droppedFrames++;
+            return;
+        }
+        GLuint64 depthSamples {0}, shadedSamples {0};
+        glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &depthSamples);
+        glGetQueryObjectui64v(frame.queries[1], GL_QUERY_RESULT, &shadedSamples);
+        coveredPixels = shadedSamples;
+        overdraw = shadedSamples > 0 ? (double)depthSamples / shadedSamples : 0.0;
+
+        if (overdraw > enableOverdraw) enabled = true;
+        else if (overdraw < disableOverdraw) enabled = false;
+    }
+};
@@ -0,0 +1,535 @@
+#pragma once
+
+#include "BufferPool.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Hash.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "ShaderPermutations.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Everything needed to draw one mesh, resolved once when the model is loaded
+struct DrawPacket {
+    // Shader permutation bits, with the matching #define keys in featureKeys
+    enum Feature : uint32_t { DiffuseTexture = 1u << 0, SpecularTexture = 1u << 1 };
+    static const std::vector<std::string> featureKeys;
+
+    // Vertex format, index type, texture set and material ids; the program is added on submission
+    uint64_t sortKey {0};
+    uint32_t features {0};
+    // Values the texture set and material ids were taken for, given back by DrawList::release()
+    uint64_t textureSet {0}, materialHash {0};
+
+    // Bind record
+    BufferPool *pool {nullptr};
+    unsigned int diffuseTex {0}, specularTex {0};
+    Mesh::Material material;
+    glm::vec3 positionScale {glm::vec3(1.0f)}, positionOffset {glm::vec3(0.0f)};
+
+    // Draw call
+    GLsizei indexCount {0};
+    GLenum indexType {GL_UNSIGNED_INT};
+    size_t indexOffset {0};
+    GLint baseVertex {0};
+};
+
+// Per-frame list of packets, sorted before execution so that programs, vertex arrays,
+// textures and material uniforms are only set when they differ from the previous draw.
+class DrawList
+{
+public:
+    struct StateCounter {
+        unsigned int issued {0}, elided {0};
+    };
+
+    struct Stats {
+        // Meshes drawn, and GL draw calls used for that
+        unsigned int draws {0}, calls {0};
+        StateCounter programs, vertexArrays, textures, materials, transforms;
+
+        unsigned int issued() const
+        {
+            return programs.issued + vertexArrays.issued + textures.issued + materials.issued + transforms.issued;
+        }
+        unsigned int elided() const
+        {
+            return programs.elided + vertexArrays.elided + textures.elided + materials.elided + transforms.elided;
+        }
+    };
+
+    // Sort key, from most to least expensive state:
+    // program (16 bits) | vertex format and index type (4 bits) | texture set (24 bits) | material (20 bits)
+    // The key only orders draws: binds are skipped by comparing the actual state. Ids are
+    // reference counted, call release() for each compiled packet that is no longer drawn.
+    static DrawPacket compile(const Mesh &mesh)
+    {
+        DrawPacket packet;
+        packet.pool = &mesh.getPool();
+        // Texture types are only compared once, here
+        for (const Texture &texture : mesh.getTextures()) {
+            if (texture.type == "diffuse" && packet.diffuseTex == 0) packet.diffuseTex = texture.id;
+            else if (texture.type == "specular" && packet.specularTex == 0) packet.specularTex = texture.id;
+        }
+        if (packet.diffuseTex != 0) packet.features |= DrawPacket::DiffuseTexture;
+        if (packet.specularTex != 0) packet.features |= DrawPacket::SpecularTexture;
+        packet.material = mesh.getMaterial();
+        packet.positionScale = mesh.getPositionScale();
+        packet.positionOffset = mesh.getPositionOffset();
+        packet.indexCount = mesh.getIndexCount();
+        packet.indexType = mesh.getIndexType();
+        packet.indexOffset = mesh.getAllocation().indexOffset;
+        packet.baseVertex = mesh.getAllocation().baseVertex;
+
+        packet.textureSet = (uint64_t)packet.diffuseTex << 32 | packet.specularTex;
+        packet.materialHash = materialHash(packet.material);
+        uint64_t textureSet = textureSetIds().acquire(packet.textureSet);
+        uint64_t material = materialIds().acquire(packet.materialHash);
+        uint64_t buffers = (uint64_t)packet.pool->getVertexFormat() << 1 | (packet.indexType == GL_UNSIGNED_SHORT);
+        packet.sortKey = (buffers & 0xF) << 44 | (textureSet & 0xFFFFFF) << 20 | (material & 0xFFFFF);
+        return packet;
+    }
+
+    // Gives back the ids taken by compile(), so that they can be reused
+    static void release(const DrawPacket &packet)
+    {
+        textureSetIds().release(packet.textureSet);
+        materialIds().release(packet.materialHash);
+    }
+
+    void clear()
+    {
+        items.clear();
+        indirectPrepared = false;
+    }
+
+    // The packet and the shader must outlive the next execute() call
+    void submit(const DrawPacket &packet, const Shader &shader, const glm::mat4 &modelMat)
+    {
+        assert(shader.ID <= 0xFFFF && "program name does not fit the sort key");
+        items.push_back({(uint64_t)(shader.ID & 0xFFFF) << 48 | packet.sortKey, &packet, &shader, modelMat});
+        indirectPrepared = false;
+    }
+
+    // Same, with the permutation matching the packet's features
+    void submit(const DrawPacket &packet, ShaderPermutations &shaders, const glm::mat4 &modelMat)
+    {
+        submit(packet, shaders.get(packet.features), modelMat);
+    }
+
+    // Draw every submitted packet. Bindings are tracked from scratch on each call, so state
+    // changed by other code between two frames is never assumed.
+    void execute()
+    {
+        sortItems();
+        stats = Stats();
+
+        const Shader *program {nullptr};
+        const MaterialUniforms *uniforms {nullptr};
+        const BufferPool *pool {nullptr};
+        // Packets whose textures and material are currently bound
+        const DrawPacket *textured {nullptr}, *material {nullptr};
+        const Item *previous {nullptr};
+
+        for (const Item &item : items) {
+            const DrawPacket &packet = *item.packet;
+
+            if (item.shader != program) {
+                program = item.shader;
+                program->use();
+                uniforms = &getUniforms(*program);
+                // Fixed texture units for the material samplers
+                uniforms->diffuseTex.set(diffuseTexUnit);
+                uniforms->specularTex.set(specularTexUnit);
+                pool = nullptr;
+                textured = material = nullptr;
+                previous = nullptr;
+                stats.programs.issued++;
+            }
+            else stats.programs.elided++;
+
+            if (packet.pool != pool) {
+                pool = packet.pool;
+                packet.pool->bind();
+                stats.vertexArrays.issued++;
+            }
+            else stats.vertexArrays.elided++;
+
+            if (!textured || packet.diffuseTex != textured->diffuseTex || packet.specularTex != textured->specularTex) {
+                textured = &packet;
+                GLState::bindTexture(diffuseTexUnit, GL_TEXTURE_2D, packet.diffuseTex);
+                GLState::bindTexture(specularTexUnit, GL_TEXTURE_2D, packet.specularTex);
+                stats.textures.issued++;
+            }
+            else stats.textures.elided++;
+
+            if (!material || !sameMaterial(packet.material, material->material)) {
+                material = &packet;
+                uniforms->ambientColor.set(packet.material.ambientColor);
+                uniforms->diffuseColor.set(packet.material.diffuseColor);
+                uniforms->specularColor.set(packet.material.specularColor);
+                uniforms->shininess.set(packet.material.shininess);
+                stats.materials.issued++;
+            }
+            else stats.materials.elided++;
+
+            if (!previous || item.modelMat != previous->modelMat
+                || packet.positionScale != previous->packet->positionScale
+                || packet.positionOffset != previous->packet->positionOffset) {
+                uniforms->model.set(item.modelMat);
+                uniforms->positionScale.set(packet.positionScale);
+                uniforms->positionOffset.set(packet.positionOffset);
+                stats.transforms.issued++;
+            }
+            else stats.transforms.elided++;
+            previous = &item;
+
+            glDrawElementsBaseVertex(GL_TRIANGLES, packet.indexCount, packet.indexType, (void*)packet.indexOffset,
+                                     packet.baseVertex);
+            stats.draws++;
+            stats.calls++;
+        }
+    }
+
+    // Same as execute() with one glMultiDrawElementsIndirect call per run of packets sharing
+    // a program, vertex array, index type and texture set: samplers are then the same for the
+    // whole call, as GLSL requires (no dynamically non-uniform sampler indexing). Per-draw
+    // transforms and materials go to a shader storage buffer (Shaders/DrawBuffer.glsl).
+    // Only untextured packets and meshes sharing their textures are merged: a model with
+    // distinct textures per mesh still costs about one call per mesh, saving the transform
+    // and material uniforms only. Textures indexed per draw would need bindless textures or
+    // same-sized texture arrays, neither of which this path assumes.
+    // Needs GLExtensions::hasMultiDrawIndirect().
+    void executeIndirect()
+    {
+        prepareIndirect();
+        stats = Stats();
+        stats.draws = items.size();
+        // Every draw uploads its material and transform to the draw buffer
+        stats.materials.issued = stats.transforms.issued = items.size();
+
+        const Shader *program {nullptr};
+        const BufferPool *pool {nullptr};
+        for (const Batch &batch : batches) {
+            if (batch.program != program) {
+                program = batch.program;
+                program->use();
+                const MaterialUniforms &uniforms = getUniforms(*program);
+                uniforms.diffuseTex.set(diffuseTexUnit);
+                uniforms.specularTex.set(specularTexUnit);
+                stats.programs.issued++;
+            }
+            else stats.programs.elided++;
+
+            if (batch.pool != pool) {
+                if (pool) unbindIndirectVertexArray();
+                pool = batch.pool;
+                bindIndirectVertexArray(*pool);
+                stats.vertexArrays.issued++;
+            }
+            else stats.vertexArrays.elided++;
+
+            // Batches are split on texture set changes, the sort key keeps them contiguous
+            GLState::bindTexture(diffuseTexUnit, GL_TEXTURE_2D, batch.diffuseTex);
+            GLState::bindTexture(specularTexUnit, GL_TEXTURE_2D, batch.specularTex);
+            stats.textures.issued++;
+
+            GLExtensions::multiDrawElementsIndirect(GL_TRIANGLES, batch.indexType,
+                                                    (void*)(batch.first * sizeof(GLExtensions::DrawElementsIndirectCommand)),
+                                                    batch.count, 0);
+            stats.calls++;
+        }
+        if (pool) unbindIndirectVertexArray();
+    }
+
+    // Depth-only draw of every submitted packet with depthShader, for a depth pre-pass before
+    // execute(): only vertex arrays and transforms are set. Stats are left to execute().
+    void executeDepth(const Shader &depthShader)
+    {
+        sortItems();
+        depthShader.use();
+        const MaterialUniforms &uniforms = getUniforms(depthShader);
+        const BufferPool *pool {nullptr};
+        const Item *previous {nullptr};
+        for (const Item &item : items) {
+            const DrawPacket &packet = *item.packet;
+            if (packet.pool != pool) {
+                pool = packet.pool;
+                packet.pool->bind();
+            }
+            if (!previous || item.modelMat != previous->modelMat
+                || packet.positionScale != previous->packet->positionScale
+                || packet.positionOffset != previous->packet->positionOffset) {
+                uniforms.model.set(item.modelMat);
+                uniforms.positionScale.set(packet.positionScale);
+                uniforms.positionOffset.set(packet.positionOffset);
+            }
+            previous = &item;
+
+            glDrawElementsBaseVertex(GL_TRIANGLES, packet.indexCount, packet.indexType, (void*)packet.indexOffset,
+                                     packet.baseVertex);
+        }
+    }
+
+    // Same for executeIndirect(), which then reuses the draw buffers filled here. Textures do
+    // not matter, so consecutive batches sharing a vertex array and an index type are drawn
+    // with one call. depthShader reads the draw buffer of Shaders/DrawBuffer.glsl.
+    void executeIndirectDepth(const Shader &depthShader)
+    {
+        prepareIndirect();
+        depthShader.use();
+        const BufferPool *pool {nullptr};
+        for (unsigned int i = 0; i < batches.size();) {
+            const Batch &first = batches[i];
+            unsigned int count {0};
+            for (; i < batches.size() && batches[i].pool == first.pool && batches[i].indexType == first.indexType; i++)
+                count += batches[i].count;
+
+            if (first.pool != pool) {
+                if (pool) unbindIndirectVertexArray();
+                pool = first.pool;
+                bindIndirectVertexArray(*pool);
+            }
+            GLExtensions::multiDrawElementsIndirect(GL_TRIANGLES, first.indexType,
+                                                    (void*)(first.first * sizeof(GLExtensions::DrawElementsIndirectCommand)),
+                                                    count, 0);
+        }
+        if (pool) unbindIndirectVertexArray();
+    }
+
+    // Counters of the last execute() call
+    const Stats &getStats() { return stats; }
+
+private:
+    struct Item {
+        uint64_t key;
+        const DrawPacket *packet;
+        const Shader *shader;
+        glm::mat4 modelMat;
+    };
+
+    struct MaterialUniforms {
+        Shader::Uniform<glm::mat4> model;
+        Shader::Uniform<glm::vec3> positionScale, positionOffset;
+        Shader::Uniform<int> diffuseTex, specularTex;
+        Shader::Uniform<glm::vec3> ambientColor, diffuseColor, specularColor;
+        Shader::Uniform<float> shininess;
+    };
+
+    // Per-draw data of the indirect path, std430 layout of DrawData in Shaders/DrawBuffer.glsl
+    struct DrawData {
+        glm::mat4 model;
+        glm::vec4 positionScale, positionOffset;
+        glm::vec4 ambientColor, diffuseColor;
+        // Shininess in w
+        glm::vec4 specularColor;
+    };
+
+    // Draws of the indirect path sharing one glMultiDrawElementsIndirect call
+    struct Batch {
+        const Shader *program;
+        const BufferPool *pool;
+        GLenum indexType;
+        unsigned int diffuseTex, specularTex;
+        // Range of items (and commands)
+        unsigned int first, count {0};
+    };
+
+    // Units 0 is left for shadow mapping
+    static constexpr int diffuseTexUnit {1}, specularTexUnit {2};
+    // Instanced attribute holding 0, 1, 2... (gl_DrawID needs OpenGL 4.6)
+    static constexpr unsigned int drawIdAttribute {3};
+
+    std::vector<Item> items;
+    std::unordered_map<unsigned int, MaterialUniforms> uniformsByProgram;
+    Stats stats;
+
+    // Batches of the indirect path, valid until the next submission while indirectPrepared
+    std::vector<Batch> batches;
+    bool indirectPrepared {false};
+
+    unsigned int drawDataBuffer {0}, commandBuffer {0}, drawIdBuffer {0};
+    size_t drawIdCount {0};
+
+    void sortItems()
+    {
+        std::stable_sort(items.begin(), items.end(), [](const Item &a, const Item &b) { return a.key < b.key; });
+    }
+
+    // Splits the items into batches and uploads their draw data and commands, once per
+    // submission for both executeIndirectDepth() and executeIndirect()
+    void prepareIndirect()
+    {
+        if (indirectPrepared) return;
+        indirectPrepared = true;
+        sortItems();
+        batches.clear();
+        if (items.empty()) return;
+
+        std::vector<DrawData> drawData(items.size());
+        std::vector<GLExtensions::DrawElementsIndirectCommand> commands(items.size());
+        for (unsigned int i = 0; i < items.size(); i++) {
+            const Item &item = items[i];
+            const DrawPacket &packet = *item.packet;
+
+            bool sameState = !batches.empty() && batches.back().program == item.shader
+                             && batches.back().pool == packet.pool && batches.back().indexType == packet.indexType
+                             && batches.back().diffuseTex == packet.diffuseTex
+                             && batches.back().specularTex == packet.specularTex;
+            if (!sameState)
+                batches.push_back({item.shader, packet.pool, packet.indexType, packet.diffuseTex, packet.specularTex, i});
+            batches.back().count++;
+
+            DrawData &data = drawData[i];
+            data.model = item.modelMat;
+            data.positionScale = glm::vec4(packet.positionScale, 0.0f);
+            data.positionOffset = glm::vec4(packet.positionOffset, 0.0f);
+            data.ambientColor = glm::vec4(packet.material.ambientColor, 0.0f);
+            data.diffuseColor = glm::vec4(packet.material.diffuseColor, 0.0f);
+            data.specularColor = glm::vec4(packet.material.specularColor, packet.material.shininess);
+
+            // The base instance selects the draw data through the instanced draw id attribute
+            commands[i] = {(GLuint)packet.indexCount, 1, (GLuint)(packet.indexOffset / Mesh::indexSize(packet.indexType)),
+                           packet.baseVertex, i};
+        }
+        uploadIndirectBuffers(drawData, commands);
+    }
+
+    void bindIndirectVertexArray(const BufferPool &pool)
+    {
+        pool.bind();
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glEnableVertexAttribArray(drawIdAttribute);
+        glVertexAttribIPointer(drawIdAttribute, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(drawIdAttribute, 1);
+    }
+
+    // The vertex arrays are shared with execute() and other direct draws, which must not
+    // read the instanced draw id. Called while the array to restore is still bound.
+    void unbindIndirectVertexArray()
+    {
+        glVertexAttribDivisor(drawIdAttribute, 0);
+        glDisableVertexAttribArray(drawIdAttribute);
+    }
+
+    void uploadIndirectBuffers(const std::vector<DrawData> &drawData,
+                               const std::vector<GLExtensions::DrawElementsIndirectCommand> &commands)
+    {
+        if (drawDataBuffer == 0) {
+            glGenBuffers(1, &drawDataBuffer);
+            glGenBuffers(1, &commandBuffer);
+            glGenBuffers(1, &drawIdBuffer);
+        }
+        // Orphaned every frame so that the driver does not wait for the previous frame
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, drawData.size() * sizeof(DrawData), drawData.data(), GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawDataBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(commands[0]), commands.data(), GL_STREAM_DRAW);
+
+        // Draw ids never change, the buffer only grows
+        if (drawIdCount < drawData.size()) {
+            drawIdCount = std::max(drawData.size(), 2 * drawIdCount);
+            std::vector<GLuint> ids(drawIdCount);
+            for (GLuint i = 0; i < ids.size(); i++) ids[i] = i;
+            glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+            glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+        }
+    }
+
+    const MaterialUniforms &getUniforms(const Shader &shader)
+    {
+        auto it = uniformsByProgram.find(shader.ID);
+        if (it != uniformsByProgram.end()) return it->second;
+
+        std::string prefix = materialUniformName + ".";
+        MaterialUniforms uniforms;
+        uniforms.model = shader.uniform<glm::mat4>("model");
+        uniforms.positionScale = shader.uniform<glm::vec3>(positionScaleUniformName);
+        uniforms.positionOffset = shader.uniform<glm::vec3>(positionOffsetUniformName);
+        uniforms.diffuseTex = shader.uniform<int>(prefix + diffuseTexField);
+        uniforms.specularTex = shader.uniform<int>(prefix + specularTexField);
+        uniforms.ambientColor = shader.uniform<glm::vec3>(prefix + ambientColorField);
+        uniforms.diffuseColor = shader.uniform<glm::vec3>(prefix + diffuseColorField);
+        uniforms.specularColor = shader.uniform<glm::vec3>(prefix + specularColorField);
+        uniforms.shininess = shader.uniform<float>(prefix + shininessField);
+        return uniformsByProgram.emplace(shader.ID, uniforms).first->second;
+    }
+
+    // Small ids for the texture set and material fields of sort keys, shared by every model
+    // (GL thread only). Reference counted so that released ids are reused and never outgrow
+    // their field.
+    class KeyIds
+    {
+    public:
+        explicit KeyIds(const uint64_t &limit) : limit(limit) {}
+
+        uint64_t acquire(const uint64_t &value)
+        {
+            auto it = ids.find(value);
+            if (it != ids.end()) {
+                it->second.refCount++;
+                return it->second.id;
+            }
+            uint64_t id = next;
+            if (!freeIds.empty()) {
+                id = freeIds.back();
+                freeIds.pop_back();
+            }
+            else next++;
+            assert(id < limit && "sort key id does not fit its field");
+            ids.emplace(value, Entry {id, 1});
+            return id;
+        }
+
+        void release(const uint64_t &value)
+        {
+            auto it = ids.find(value);
+            if (it == ids.end() || --it->second.refCount > 0) return;
+            freeIds.push_back(it->second.id);
+            ids.erase(it);
+        }
+
+    private:
+        struct Entry {
+            uint64_t id;
+            unsigned int refCount;
+        };
+        uint64_t limit, next {0};
+        std::unordered_map<uint64_t, Entry> ids;
+        std::vector<uint64_t> freeIds;
+    };
+
+    static KeyIds &textureSetIds()
+    {
+        static KeyIds ids(1ull << 24);
+        return ids;
+    }
+
+    static KeyIds &materialIds()
+    {
+        static KeyIds ids(1ull << 20);
+        return ids;
+    }
+
+    static uint64_t materialHash(const Mesh::Material &material)
+    {
+        uint64_t hash = Hash::fnv1a(&material.ambientColor, sizeof(material.ambientColor));
+        hash = Hash::fnv1a(&material.diffuseColor, sizeof(material.diffuseColor), hash);
+        hash = Hash::fnv1a(&material.specularColor, sizeof(material.specularColor), hash);
+        return Hash::fnv1a(&material.shininess, sizeof(material.shininess), hash);
+    }
+
+    static bool sameMaterial(const Mesh::Material &a, const Mesh::Material &b)
+    {
+        return a.ambientColor == b.ambientColor && a.diffuseColor == b.diffuseColor
+               && a.specularColor == b.specularColor && a.shininess == b.shininess;
+    }
+};
+
+const std::vector<std::string> DrawPacket::featureKeys {"HAS_DIFFUSE_TEX", "HAS_SPECULAR_TEX"};
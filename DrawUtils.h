@@ -1,5 +1,7 @@
 #pragma once
 
+#include "GLState.h"
+
 #include <glad/glad.h>
 
 class DrawUtils
@@ -16,7 +18,7 @@ public:
 			};
 			// initialize vertex attributs layout
 			glGenVertexArrays(1, &vao);
-			glBindVertexArray(vao);
+			GLState::bindVertexArray(vao);
 			// Prepare GPU buffer for receiving 3D positions
 			glGenBuffers(1, &vbo);
 			glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -28,9 +30,8 @@ public:
 			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 		}
 
-		glBindVertexArray(vao);
+		GLState::bindVertexArray(vao);
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-		glBindVertexArray(0);
 	}
 
 	static void renderCube(unsigned int &vao, unsigned int &vbo)
@@ -88,7 +89,7 @@ public:
 			glBindBuffer(GL_ARRAY_BUFFER, vbo);
 			glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 			// link vertex attributes
-			glBindVertexArray(vao);
+			GLState::bindVertexArray(vao);
 			glEnableVertexAttribArray(0);
 			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 			glEnableVertexAttribArray(1);
@@ -96,11 +97,10 @@ public:
 			glEnableVertexAttribArray(2);
 			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			glBindVertexArray(0);
+			GLState::bindVertexArray(0);
 		}
 		// render Cube
-		glBindVertexArray(vao);
+		GLState::bindVertexArray(vao);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glBindVertexArray(0);
 	}
 };
\ No newline at end of file
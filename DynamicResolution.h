@@ -0,0 +1,59 @@
+#pragma once
+
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Picks the render scale of the offscreen passes (see RenderTargets) that keeps the GPU time
+// of a frame under a budget. Rendering cost is taken as proportional to the pixel count, that
+// is to the square of the scale. Scales are multiples of scaleStep so that only a few target
+// sizes are ever used. After a change, results of frames rendered at the previous scale are
+// skipped, then the next decision is made from the average of averagedFrames new results.
+// Only GPU time is considered: lowering the scale does not help a CPU-bound frame.
+class DynamicResolution
+{
+public:
+    static constexpr float minScale {0.5f}, maxScale {1.0f}, scaleStep {0.05f};
+    static constexpr unsigned int averagedFrames {8};
+
+    explicit DynamicResolution(const double &targetMs) : targetMs(targetMs) {}
+
+    // Call with each new GPU frame time (GpuProfiler::getLatest("Frame")). Returns the scale
+    // for the next frames.
+    float update(const double &gpuFrameMs)
+    {
+        if (++results <= GpuProfiler::frameLatency) return scale;
+        totalMs += gpuFrameMs;
+        if (results < GpuProfiler::frameLatency + averagedFrames) return scale;
+        double averageMs = totalMs / averagedFrames;
+        totalMs = 0.0;
+        results = GpuProfiler::frameLatency;
+
+        float next = scale;
+        // Over budget: jump to the estimated scale, with some headroom
+        if (averageMs > 0.95 * targetMs)
+            next = std::min(quantize(scale * std::sqrt(0.9 * targetMs / averageMs)), scale - scaleStep);
+        // Well under budget: one step up costs about 10 to 20% more
+        else if (averageMs < 0.75 * targetMs)
+            next = scale + scaleStep;
+        next = std::min(std::max(next, minScale), maxScale);
+        if (std::fabs(next - scale) > 0.5f * scaleStep) {
+            scale = quantize(next);
+            results = 0;
+        }
+        return scale;
+    }
+
+    float getScale() { return scale; }
+    double getTargetMs() { return targetMs; }
+
+private:
+    double targetMs;
+    float scale {maxScale};
+    // Results received since the last change
+    unsigned int results {0};
+    double totalMs {0.0};
+
+    static float quantize(const float &value) { return std::floor(value / scaleStep + 0.01f) * scaleStep; }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Camera.h"
+#include "Shader.h"
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+// Uniform buffer behind the FrameData block of Shaders/FrameData.glsl, which shaders
+// #include. Bound once to Shader::frameDataBinding; programs are attached to that binding
+// point when linked.
+class FrameData
+{
+public:
+    // std140 layout of the FrameData block
+    struct Block {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 inverseView;
+        glm::mat4 inverseProjection;
+        glm::vec3 cameraPos;
+        // Seconds since startup
+        float time;
+        glm::vec2 viewportSize;
+        glm::vec2 padding;
+    };
+    static_assert(sizeof(Block) == 288, "FrameData must match the std140 layout of the GLSL block");
+
+    // Once per frame, before any pass. Camera matrices are only recomputed and uploaded when
+    // the camera or the viewport changed; otherwise only the time is written.
+    void update(Camera &camera, const unsigned int &widthPx, const unsigned int &heightPx, const float &time)
+    {
+        if (UBO == 0) {
+            glGenBuffers(1, &UBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, Shader::frameDataBinding, UBO);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        block.time = time;
+
+        glm::vec2 viewportSize(widthPx, heightPx);
+        bool cameraChanged = camera.consumeChanges();
+        if (cameraChanged || viewportSize != block.viewportSize) {
+            block.view = camera.getViewMatrix();
+            block.projection = camera.getProjMatrix(widthPx, heightPx);
+            block.inverseView = glm::inverse(block.view);
+            block.inverseProjection = glm::inverse(block.projection);
+            block.cameraPos = camera.getPosition();
+            block.viewportSize = viewportSize;
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+            cameraUpdates++;
+        }
+        else glBufferSubData(GL_UNIFORM_BUFFER, offsetof(Block, time), sizeof(block.time), &block.time);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // CPU copy of the last uploaded data
+    const Block &get() { return block; }
+
+    // Number of frames which needed new camera matrices
+    unsigned int getCameraUpdates() { return cameraUpdates; }
+
+private:
+    unsigned int UBO {0};
+    Block block {};
+    unsigned int cameraUpdates {0};
+};
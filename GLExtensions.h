@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// The bundled glad loader stops at OpenGL 3.3. Entry points and enums used by optional
+// paths of newer contexts are declared and loaded here; every path checks for support
+// and falls back to 3.3 core when it is missing.
+
+#ifndef GL_VERSION_4_3
+#define GL_DRAW_INDIRECT_BUFFER  0x8F3F
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC) (GLenum mode, GLenum type, const void *indirect,
+                                                             GLsizei drawcount, GLsizei stride);
+#endif
+
+#ifndef GL_VERSION_4_1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#define GL_PROGRAM_BINARY_FORMATS          0x87FF
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC) (GLuint program, GLsizei bufSize, GLsizei *length,
+                                                    GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC) (GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC) (GLuint program, GLenum pname, GLint value);
+#endif
+
+#ifndef GL_KHR_parallel_shader_compile
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) (GLuint count);
+#endif
+
+namespace GLExtensions
+{
+    // Layout of the commands read by glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    inline PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect {nullptr};
+    inline PFNGLGETPROGRAMBINARYPROC getProgramBinary {nullptr};
+    inline PFNGLPROGRAMBINARYPROC programBinary {nullptr};
+    inline PFNGLPROGRAMPARAMETERIPROC programParameteri {nullptr};
+    inline PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads {nullptr};
+    // Binary formats accepted by programBinary
+    inline std::vector<GLint> programBinaryFormats;
+
+    inline bool hasVersion(const int &major, const int &minor)
+    {
+        return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+    }
+
+    inline bool hasExtension(const char *name)
+    {
+        int count {0};
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (int i = 0; i < count; i++)
+            if (std::strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+        return false;
+    }
+
+    // Multi-draw-indirect with shader storage buffers (OpenGL 4.3)
+    inline bool hasMultiDrawIndirect() { return multiDrawElementsIndirect != nullptr; }
+
+    // Retrieval and upload of linked programs (OpenGL 4.1 or ARB_get_program_binary),
+    // only reported when the driver has at least one binary format
+    inline bool hasProgramBinary() { return programBinary != nullptr; }
+
+    inline bool isProgramBinaryFormat(const GLenum &format)
+    {
+        return std::find(programBinaryFormats.begin(), programBinaryFormats.end(), (GLint)format)
+               != programBinaryFormats.end();
+    }
+
+    // Compilation and linking on driver threads (KHR_parallel_shader_compile, or its ARB
+    // predecessor which has the same enums)
+    inline bool hasParallelShaderCompile() { return maxShaderCompilerThreads != nullptr; }
+
+    // Call once after gladLoadGLLoader, with the same loader
+    inline void load(GLADloadproc loader)
+    {
+        if (hasVersion(4, 3))
+            multiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)loader("glMultiDrawElementsIndirect");
+
+        if (hasVersion(4, 1) || hasExtension("GL_ARB_get_program_binary")) {
+            int formats {0};
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            if (formats > 0) {
+                getProgramBinary = (PFNGLGETPROGRAMBINARYPROC)loader("glGetProgramBinary");
+                programBinary = (PFNGLPROGRAMBINARYPROC)loader("glProgramBinary");
+                programParameteri = (PFNGLPROGRAMPARAMETERIPROC)loader("glProgramParameteri");
+                if (!getProgramBinary || !programParameteri) programBinary = nullptr;
+                programBinaryFormats.resize(formats);
+                glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, programBinaryFormats.data());
+            }
+        }
+
+        if (hasExtension("GL_KHR_parallel_shader_compile"))
+            maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+        else if (hasExtension("GL_ARB_parallel_shader_compile"))
+            maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+
+        std::cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor << " context, multi-draw-indirect "
+                  << (hasMultiDrawIndirect() ? "available" : "unavailable") << ", program binaries "
+                  << (hasProgramBinary() ? "available" : "unavailable") << ", parallel shader compilation "
+                  << (hasParallelShaderCompile() ? "available" : "unavailable") << std::endl;
+    }
+}
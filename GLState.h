@@ -0,0 +1,178 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// Shadow copy of the bindings most often changed while rendering: program, vertex array,
+// framebuffers, active texture unit and per-unit textures. Every bind of the application
+// goes through here, so a call matching the current binding is skipped. Objects must be
+// deleted through here as well, since GL resets the bindings of deleted objects to 0.
+// All functions must be called from the thread owning the GL context.
+namespace GLState
+{
+    struct Counter {
+        unsigned int issued {0}, elided {0};
+    };
+
+    struct Stats {
+        Counter programs, vertexArrays, framebuffers, activeTextures, textures;
+
+        unsigned int issued() const
+        {
+            return programs.issued + vertexArrays.issued + framebuffers.issued + activeTextures.issued + textures.issued;
+        }
+        unsigned int elided() const
+        {
+            return programs.elided + vertexArrays.elided + framebuffers.elided + activeTextures.elided + textures.elided;
+        }
+    };
+
+    // Binding not known yet (before the first call or after invalidate()), never matches
+    constexpr unsigned int unknown {~0u};
+
+    // Texture targets with a shadowed binding, other targets are always issued
+    constexpr std::array<GLenum, 3> trackedTargets {GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY};
+    using UnitBindings = std::array<unsigned int, trackedTargets.size()>;
+
+    inline unsigned int currentProgram {unknown}, currentVertexArray {unknown};
+    inline unsigned int currentDrawFramebuffer {unknown}, currentReadFramebuffer {unknown};
+    inline unsigned int currentUnit {unknown};
+    inline std::vector<UnitBindings> textureBindings;
+    inline Stats frameStats, lastFrameStats;
+
+    inline int targetIndex(const GLenum &target)
+    {
+        for (unsigned int i = 0; i < trackedTargets.size(); i++)
+            if (trackedTargets[i] == target) return i;
+        return -1;
+    }
+
+    inline bool update(unsigned int &current, const unsigned int &value, Counter &counter)
+    {
+        if (current == value) {
+            counter.elided++;
+            return false;
+        }
+        current = value;
+        counter.issued++;
+        return true;
+    }
+
+    // Forget every binding, e.g. after code not going through here changed them
+    inline void invalidate()
+    {
+        currentProgram = currentVertexArray = unknown;
+        currentDrawFramebuffer = currentReadFramebuffer = unknown;
+        currentUnit = unknown;
+        UnitBindings unknownBindings;
+        unknownBindings.fill(unknown);
+        std::fill(textureBindings.begin(), textureBindings.end(), unknownBindings);
+    }
+
+    inline void useProgram(const unsigned int &program)
+    {
+        if (update(currentProgram, program, frameStats.programs)) glUseProgram(program);
+    }
+
+    inline void bindVertexArray(const unsigned int &vertexArray)
+    {
+        if (update(currentVertexArray, vertexArray, frameStats.vertexArrays)) glBindVertexArray(vertexArray);
+    }
+
+    // GL_FRAMEBUFFER binds both the draw and read framebuffers
+    inline void bindFramebuffer(const GLenum &target, const unsigned int &framebuffer)
+    {
+        bool draw = target != GL_READ_FRAMEBUFFER && currentDrawFramebuffer != framebuffer;
+        bool read = target != GL_DRAW_FRAMEBUFFER && currentReadFramebuffer != framebuffer;
+        if (!draw && !read) {
+            frameStats.framebuffers.elided++;
+            return;
+        }
+        if (target != GL_READ_FRAMEBUFFER) currentDrawFramebuffer = framebuffer;
+        if (target != GL_DRAW_FRAMEBUFFER) currentReadFramebuffer = framebuffer;
+        frameStats.framebuffers.issued++;
+        glBindFramebuffer(target, framebuffer);
+    }
+
+    // Unit index, not GL_TEXTUREi
+    inline void activeTexture(const unsigned int &unit)
+    {
+        if (update(currentUnit, unit, frameStats.activeTextures)) glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // Bind on the given unit, only switching the active unit when the binding changes
+    inline void bindTexture(const unsigned int &unit, const GLenum &target, const unsigned int &texture)
+    {
+        int index = targetIndex(target);
+        if (index < 0) {
+            activeTexture(unit);
+            frameStats.textures.issued++;
+            glBindTexture(target, texture);
+            return;
+        }
+        if (unit >= textureBindings.size()) {
+            UnitBindings unknownBindings;
+            unknownBindings.fill(unknown);
+            textureBindings.resize(unit + 1, unknownBindings);
+        }
+        if (textureBindings[unit][index] == texture) {
+            frameStats.textures.elided++;
+            return;
+        }
+        activeTexture(unit);
+        update(textureBindings[unit][index], texture, frameStats.textures);
+        glBindTexture(target, texture);
+    }
+
+    // Bind on the current unit, typically to create or update a texture
+    inline void bindTexture(const GLenum &target, const unsigned int &texture)
+    {
+        if (currentUnit == unknown) activeTexture(0);
+        bindTexture(currentUnit, target, texture);
+    }
+
+    inline void deleteProgram(const unsigned int &program)
+    {
+        // A program in use is only flagged for deletion, its name may come back later
+        if (currentProgram == program) currentProgram = unknown;
+        glDeleteProgram(program);
+    }
+
+    inline void deleteVertexArrays(const int &count, const unsigned int *vertexArrays)
+    {
+        for (int i = 0; i < count; i++)
+            if (currentVertexArray == vertexArrays[i]) currentVertexArray = 0;
+        glDeleteVertexArrays(count, vertexArrays);
+    }
+
+    inline void deleteFramebuffers(const int &count, const unsigned int *framebuffers)
+    {
+        for (int i = 0; i < count; i++) {
+            if (currentDrawFramebuffer == framebuffers[i]) currentDrawFramebuffer = 0;
+            if (currentReadFramebuffer == framebuffers[i]) currentReadFramebuffer = 0;
+        }
+        glDeleteFramebuffers(count, framebuffers);
+    }
+
+    // Every unit binding of a deleted texture falls back to 0
+    inline void deleteTextures(const int &count, const unsigned int *textures)
+    {
+        for (int i = 0; i < count; i++)
+            for (UnitBindings &bindings : textureBindings)
+                for (unsigned int &binding : bindings)
+                    if (binding == textures[i]) binding = 0;
+        glDeleteTextures(count, textures);
+    }
+
+    // Call once per frame: counters of the frame just finished move to getFrameStats()
+    inline void endFrame()
+    {
+        lastFrameStats = frameStats;
+        frameStats = Stats();
+    }
+
+    inline const Stats &getFrameStats() { return lastFrameStats; }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Window.h"
+
+#include <GLFW/glfw3.h>
+
+#include <memory>
+
+// Fullscreen window on the primary monitor, with mouse capture
+class GlfwWindow : public Window
+{
+public:
+    // Tries a 4.3 core context (multi-draw-indirect geometry pass) then 3.3, which is
+    // enough for everything else. Returns nullptr on failure.
+    static std::unique_ptr<GlfwWindow> create(const unsigned int &width, const unsigned int &height,
+                                              const std::string &title)
+    {
+        glfwInit();
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        GLFWwindow *handle = glfwCreateWindow(width, height, title.c_str(), glfwGetPrimaryMonitor(), NULL);
+        if (handle == NULL) {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            handle = glfwCreateWindow(width, height, title.c_str(), glfwGetPrimaryMonitor(), NULL);
+        }
+        if (handle == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return nullptr;
+        }
+        // Tell GLFW to make the context of our window the main context of current thread
+        glfwMakeContextCurrent(handle);
+        std::unique_ptr<GlfwWindow> window(new GlfwWindow(handle));
+        if (!loadGL((GLADloadproc)glfwGetProcAddress)) return nullptr;
+        return window;
+    }
+
+    ~GlfwWindow()
+    {
+        glfwDestroyWindow(handle);
+        glfwTerminate();
+    }
+
+    bool shouldClose() override { return glfwWindowShouldClose(handle); }
+    void requestClose() override { glfwSetWindowShouldClose(handle, true); }
+    void swapBuffers() override { glfwSwapBuffers(handle); }
+    void pollEvents() override { glfwPollEvents(); }
+    bool isKeyDown(const Key &key) override { return glfwGetKey(handle, glfwKey(key)) == GLFW_PRESS; }
+    void setTitle(const std::string &title) override { glfwSetWindowTitle(handle, title.c_str()); }
+    double getTime() override { return glfwGetTime(); }
+    void setVsync(const bool &enabled) override { glfwSwapInterval(enabled ? 1 : 0); }
+
+private:
+    GLFWwindow *handle;
+
+    explicit GlfwWindow(GLFWwindow *handle) : Window(0, 0), handle(handle)
+    {
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(handle, &framebufferWidth, &framebufferHeight);
+        width = framebufferWidth;
+        height = framebufferHeight;
+
+        glfwSetWindowUserPointer(handle, this);
+        glfwSetFramebufferSizeCallback(handle, [](GLFWwindow *handle, int width, int height) {
+            GlfwWindow &window = from(handle);
+            window.width = width;
+            window.height = height;
+            if (window.callbacks.resize) window.callbacks.resize(width, height);
+        });
+        // Enable cursor capture for input callbacks (& hide hint)
+        glfwSetCursorPosCallback(handle, [](GLFWwindow *handle, double x, double y) {
+            GlfwWindow &window = from(handle);
+            if (window.callbacks.mouseMove) window.callbacks.mouseMove(x, y);
+        });
+        glfwSetInputMode(handle, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwSetScrollCallback(handle, [](GLFWwindow *handle, double dx, double dy) {
+            GlfwWindow &window = from(handle);
+            if (window.callbacks.scroll) window.callbacks.scroll(dy);
+        });
+        glfwSetKeyCallback(handle, [](GLFWwindow *handle, int key, int scancode, int action, int mods) {
+            GlfwWindow &window = from(handle);
+            if (action != GLFW_PRESS || !window.callbacks.keyPressed) return;
+            for (Key candidate : {Key::Escape, Key::W, Key::A, Key::S, Key::D, Key::P})
+                if (glfwKey(candidate) == key) window.callbacks.keyPressed(candidate);
+        });
+    }
+
+    static GlfwWindow &from(GLFWwindow *handle) { return *static_cast<GlfwWindow *>(glfwGetWindowUserPointer(handle)); }
+
+    static int glfwKey(const Key &key)
+    {
+        switch (key) {
+            case Key::Escape: return GLFW_KEY_ESCAPE;
+            case Key::W: return GLFW_KEY_W;
+            case Key::A: return GLFW_KEY_A;
+            case Key::S: return GLFW_KEY_S;
+            case Key::D: return GLFW_KEY_D;
+            case Key::P: return GLFW_KEY_P;
+        }
+        return GLFW_KEY_ESCAPE;
+    }
+};
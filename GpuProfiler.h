@@ -0,0 +1,306 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GPU time of named, nestable scopes, measured with GL_TIMESTAMP queries (core since 3.3).
+// Queries of a frame are only read back frameLatency frames later, when the GPU is done with
+// them, so the CPU never waits for a result. A frame whose results are still not available
+// when its slot comes back is dropped rather than waited for. The profiler must be destroyed
+// before the GL context, which deletes its query objects.
+// Usage, once per frame:
+//     profiler.beginFrame();
+//     { GpuProfiler::Scope scope(profiler, "Geometry"); ... }
+//     profiler.endFrame();
+class GpuProfiler
+{
+public:
+    // Frames between issuing queries and reading them back
+    static constexpr unsigned int frameLatency {4};
+
+    // Times of one scope over the last historySize frames, in milliseconds
+    struct Summary {
+        std::string name;
+        // Nesting level, 0 for the whole frame
+        unsigned int depth {0};
+        unsigned int samples {0};
+        double average {0.0}, min {0.0}, max {0.0};
+        double p50 {0.0}, p95 {0.0}, p99 {0.0};
+    };
+
+    // Opens a scope for its lifetime
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler &profiler, const std::string &name) : profiler(profiler) { profiler.begin(name); }
+        ~Scope() { profiler.end(); }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        GpuProfiler &profiler;
+    };
+
+    explicit GpuProfiler(const unsigned int &historySize = 240) : historySize(historySize), frames(frameLatency)
+    {
+        // Samples are stored modulo historySize
+        if (historySize == 0) {
+            std::cout << "ERROR::GPU_PROFILER::EMPTY_HISTORY keeping 1 frame" << std::endl;
+            this->historySize = 1;
+        }
+    }
+
+    ~GpuProfiler()
+    {
+        for (Frame &frame : frames)
+            if (!frame.queries.empty()) glDeleteQueries(frame.queries.size(), frame.queries.data());
+    }
+
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    // Collects the oldest frame in flight, then opens the "Frame" scope
+    void beginFrame()
+    {
+        Frame &frame = frames[frameIndex % frameLatency];
+        if (!frame.records.empty()) collect(frame);
+        frame.records.clear();
+        frame.usedQueries = 0;
+        begin("Frame");
+    }
+
+    void endFrame()
+    {
+        end();
+        if (!open.empty()) {
+            std::cout << "ERROR::GPU_PROFILER::UNCLOSED_SCOPE " << scopes[open.back().scope].name << std::endl;
+            open.clear();
+        }
+        frameIndex++;
+    }
+
+    void begin(const std::string &name)
+    {
+        unsigned int parent = open.empty() ? noParent : open.back().scope;
+        unsigned int scope = scopeIndex(name, parent);
+        Frame &frame = frames[frameIndex % frameLatency];
+        open.push_back({scope, timestamp(frame), 0});
+    }
+
+    void end()
+    {
+        if (open.empty()) return;
+        Record record = open.back();
+        open.pop_back();
+        record.endQuery = timestamp(frames[frameIndex % frameLatency]);
+        frames[frameIndex % frameLatency].records.push_back(record);
+    }
+
+    // Scopes in first-seen order, children right after their parent
+    std::vector<Summary> getSummaries() const
+    {
+        std::vector<Summary> summaries;
+        for (unsigned int i : ordered()) {
+            const ScopeData &data = scopes[i];
+            Summary summary;
+            summary.name = data.name;
+            summary.depth = data.depth;
+            summary.samples = data.history.size();
+            if (!data.history.empty()) {
+                std::vector<double> sorted = data.history;
+                std::sort(sorted.begin(), sorted.end());
+                double total {0.0};
+                for (double value : sorted) total += value;
+                summary.average = total / sorted.size();
+                summary.min = sorted.front();
+                summary.max = sorted.back();
+                summary.p50 = percentile(sorted, 0.50);
+                summary.p95 = percentile(sorted, 0.95);
+                summary.p99 = percentile(sorted, 0.99);
+            }
+            summaries.push_back(summary);
+        }
+        return summaries;
+    }
+
+    void printReport(std::ostream &out = std::cout) const
+    {
+        out << std::left << std::setw(24) << "GPU scope (ms)" << std::right << std::fixed << std::setprecision(3);
+        for (const char *column : {"avg", "min", "max", "p50", "p95", "p99"})
+            out << std::setw(9) << column;
+        out << "   " << droppedFrames << " frame(s) dropped" << std::endl;
+        for (const Summary &summary : getSummaries()) {
+            out << std::left << std::setw(24) << std::string(2 * summary.depth, ' ') + summary.name << std::right;
+            for (double value : {summary.average, summary.min, summary.max, summary.p50, summary.p95, summary.p99})
+                out << std::setw(9) << value;
+            out << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+
+    bool writeCsv(const std::string &path) const
+    {
+        std::ofstream file(path);
+        if (!file) {
+            std::cout << "ERROR::GPU_PROFILER::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+        file << "scope,depth,samples,avg_ms,min_ms,max_ms,p50_ms,p95_ms,p99_ms\n";
+        for (const Summary &summary : getSummaries())
+            file << summary.name << "," << summary.depth << "," << summary.samples << "," << summary.average << ","
+                 << summary.min << "," << summary.max << "," << summary.p50 << "," << summary.p95 << ","
+                 << summary.p99 << "\n";
+        return true;
+    }
+
+    unsigned int getDroppedFrames() const { return droppedFrames; }
+    // Frames whose results came back so far, to tell when getLatest() has a new value
+    uint64_t getCollectedFrames() const { return collectedFrames; }
+
+    // Most recent time of a top-level scope such as "Frame", 0 before the first result
+    double getLatest(const std::string &name) const
+    {
+        auto it = scopesByKey.find(std::to_string(noParent) + "/" + name);
+        if (it == scopesByKey.end()) return 0.0;
+        const ScopeData &data = scopes[it->second];
+        if (data.history.empty()) return 0.0;
+        return data.history[(data.next + historySize - 1) % historySize];
+    }
+
+    // Forgets every sample, including frames still in flight, e.g. after warm-up frames
+    void reset()
+    {
+        for (Frame &frame : frames) frame.records.clear();
+        for (ScopeData &data : scopes) {
+            data.history.clear();
+            data.next = 0;
+        }
+        droppedFrames = 0;
+    }
+
+    // Waits for the frames still in flight and collects them, oldest first. Stalls the
+    // pipeline: only meant for the end of a run.
+    void flush()
+    {
+        glFinish();
+        for (unsigned int i = 0; i < frameLatency; i++) {
+            Frame &frame = frames[(frameIndex + i) % frameLatency];
+            if (frame.records.empty()) continue;
+            collect(frame);
+            frame.records.clear();
+        }
+    }
+
+private:
+    static constexpr unsigned int noParent {~0u};
+
+    struct Record {
+        unsigned int scope;
+        unsigned int beginQuery, endQuery;
+    };
+
+    struct Frame {
+        std::vector<unsigned int> queries;
+        unsigned int usedQueries {0};
+        std::vector<Record> records;
+    };
+
+    struct ScopeData {
+        std::string name;
+        unsigned int parent {noParent}, depth {0};
+        // Last historySize times, as a ring buffer where next is the oldest once full
+        std::vector<double> history;
+        unsigned int next {0};
+    };
+
+    unsigned int historySize;
+    std::vector<Frame> frames;
+    uint64_t frameIndex {0};
+    std::vector<Record> open;
+    std::vector<ScopeData> scopes;
+    // Scope index by parent and name
+    std::unordered_map<std::string, unsigned int> scopesByKey;
+    unsigned int droppedFrames {0};
+    uint64_t collectedFrames {0};
+
+    unsigned int scopeIndex(const std::string &name, const unsigned int &parent)
+    {
+        std::string key = std::to_string(parent) + "/" + name;
+        auto it = scopesByKey.find(key);
+        if (it != scopesByKey.end()) return it->second;
+        ScopeData data;
+        data.name = name;
+        data.parent = parent;
+        data.depth = parent == noParent ? 0 : scopes[parent].depth + 1;
+        scopes.push_back(data);
+        return scopesByKey[key] = scopes.size() - 1;
+    }
+
+    unsigned int timestamp(Frame &frame)
+    {
+        if (frame.usedQueries == frame.queries.size()) {
+            frame.queries.push_back(0);
+            glGenQueries(1, &frame.queries.back());
+        }
+        unsigned int query = frame.queries[frame.usedQueries++];
+        glQueryCounter(query, GL_TIMESTAMP);
+        return query;
+    }
+
+    // Queries complete in order, so the last one tells for the whole frame
+    void collect(const Frame &frame)
+    {
+        int available {0};
+        glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            droppedFrames++;
+            return;
+        }
+        for (const Record &record : frame.records) {
+            GLuint64 begin {0}, end {0};
+            glGetQueryObjectui64v(record.beginQuery, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(record.endQuery, GL_QUERY_RESULT, &end);
+            addSample(scopes[record.scope], (end - begin) / 1e6);
+        }
+        collectedFrames++;
+    }
+
+    void addSample(ScopeData &data, const double &ms)
+    {
+        if (data.history.size() < historySize) data.history.push_back(ms);
+        else data.history[data.next] = ms;
+        data.next = (data.next + 1) % historySize;
+    }
+
+    // Depth-first order, siblings in creation order
+    std::vector<unsigned int> ordered() const
+    {
+        std::vector<unsigned int> order;
+        appendChildren(noParent, order);
+        return order;
+    }
+
+    void appendChildren(const unsigned int &parent, std::vector<unsigned int> &order) const
+    {
+        for (unsigned int i = 0; i < scopes.size(); i++) {
+            if (scopes[i].parent != parent) continue;
+            order.push_back(i);
+            appendChildren(i, order);
+        }
+    }
+
+    static double percentile(const std::vector<double> &sorted, const double &fraction)
+    {
+        size_t index = std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5));
+        return sorted[index];
+    }
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a, used to key on-disk caches and to detect identical file contents
+namespace Hash
+{
+    const uint64_t fnvOffsetBasis {0xcbf29ce484222325ull};
+
+    inline uint64_t fnv1a(const void *data, size_t size, uint64_t hash = fnvOffsetBasis)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "GLState.h"
+#include "Window.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+// Offscreen rendering with no display server, for render nodes and CI machines. The GL
+// context comes from EGL (surfaceless Mesa platform when available, which also covers
+// llvmpipe without any GPU) and frames are rendered into a framebuffer object of the
+// requested size. There is no input: the window closes on requestClose() only.
+// Without a present to block on, swapBuffers() waits for the frame framesInFlight frames back
+// like a swap chain would, so that frame times (e.g. in benchmarks) measure rendering and not
+// only command submission.
+class HeadlessWindow : public Window
+{
+public:
+    // Tries a 4.3 core context then 3.3. Returns nullptr on failure.
+    static std::unique_ptr<HeadlessWindow> create(const unsigned int &width, const unsigned int &height)
+    {
+        std::unique_ptr<HeadlessWindow> window(new HeadlessWindow(width, height));
+        if (!window->initContext() || !loadGL((GLADloadproc)eglGetProcAddress)) return nullptr;
+        window->initFramebuffer();
+        std::cout << "Headless " << width << "x" << height << " rendering on "
+                  << (const char *)glGetString(GL_RENDERER) << std::endl;
+        return window;
+    }
+
+    ~HeadlessWindow()
+    {
+        if (display == EGL_NO_DISPLAY) return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+
+    // Frames the CPU may queue ahead of the GPU, as with double buffering
+    static constexpr unsigned int framesInFlight {2};
+
+    bool shouldClose() override { return closeRequested; }
+    void requestClose() override { closeRequested = true; }
+    // Nothing to present: the frame is submitted, then the oldest frame in flight waited for
+    void swapBuffers() override
+    {
+        frameFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        glFlush();
+        if (frameFences.size() <= framesInFlight) return;
+        glClientWaitSync(frameFences.front(), GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(frameFences.front());
+        frameFences.pop_front();
+    }
+    void pollEvents() override {}
+    bool isKeyDown(const Key &key) override { return false; }
+    void setTitle(const std::string &title) override {}
+    double getTime() override
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    unsigned int getFramebuffer() override { return framebuffer; }
+
+private:
+    EGLDisplay display {EGL_NO_DISPLAY};
+    EGLContext context {EGL_NO_CONTEXT};
+    EGLSurface surface {EGL_NO_SURFACE};
+    unsigned int framebuffer {0}, colorBuffer {0}, depthBuffer {0};
+    bool closeRequested {false};
+    std::deque<GLsync> frameFences;
+    std::chrono::steady_clock::time_point startTime {std::chrono::steady_clock::now()};
+
+    HeadlessWindow(const unsigned int &width, const unsigned int &height) : Window(width, height) {}
+
+    static bool hasExtension(const char *extensions, const char *name)
+    {
+        if (!extensions) return false;
+        size_t length = std::strlen(name);
+        for (const char *found = std::strstr(extensions, name); found; found = std::strstr(found + length, name))
+            if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+                return true;
+        return false;
+    }
+
+    bool initContext()
+    {
+        // The surfaceless platform needs neither a display server nor a GPU
+        const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+            auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay)
+                display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+        if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+            std::cout << "Failed to initialize EGL" << std::endl;
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cout << "EGL has no desktop OpenGL support" << std::endl;
+            return false;
+        }
+
+        // Without surfaceless contexts, a tiny pbuffer is made current; rendering goes to the FBO anyway
+        bool surfaceless = hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+        const EGLint configAttribs[] {
+            EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount {0};
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+            std::cout << "Failed to find an EGL config" << std::endl;
+            return false;
+        }
+
+        for (EGLint major : {4, 3}) {
+            const EGLint contextAttribs[] {
+                EGL_CONTEXT_MAJOR_VERSION, major,
+                EGL_CONTEXT_MINOR_VERSION, 3,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+            };
+            context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+            if (context != EGL_NO_CONTEXT) break;
+        }
+        if (context == EGL_NO_CONTEXT) {
+            std::cout << "Failed to create an OpenGL 3.3 context with EGL" << std::endl;
+            return false;
+        }
+
+        if (!surfaceless) {
+            const EGLint surfaceAttribs[] {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+            surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+        }
+        if (!eglMakeCurrent(display, surface, surface, context)) {
+            std::cout << "Failed to make the EGL context current" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Stands for the default framebuffer of a window: color and depth at the requested size
+    void initFramebuffer()
+    {
+        glGenFramebuffers(1, &framebuffer);
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Offscreen framebuffer not complete !" << std::endl;
+        glViewport(0, 0, width, height);
+    }
+};
@@ -12,12 +12,13 @@ public:
 	ImageBasedLighting(std::string imagePath, const unsigned int &maxMipLevels)
 		: envMapMipLevels(maxMipLevels)
 	{
+		CPU_PROFILE_SCOPE("ImageBasedLighting");
 		unsigned int cubeVAO {0}, cubeVBO {0};
 
 		// Setup envmap framebuffer
 		glGenFramebuffers(1, &envMapFBO);
 		glGenRenderbuffers(1, &envMapRBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
 		glBindRenderbuffer(GL_RENDERBUFFER, envMapRBO);
 		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
 		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, envMapRBO);
@@ -29,7 +30,7 @@ public:
 		if (data)
 		{
 			glGenTextures(1, &hdrTextureId);
-			glBindTexture(GL_TEXTURE_2D, hdrTextureId);
+			GLState::bindTexture(GL_TEXTURE_2D, hdrTextureId);
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); // note how we specify the texture's data value to be float
 
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -47,7 +48,7 @@ public:
 
 		// Setup environment cubemap
 		glGenTextures(1, &envCubeMapId);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, envCubeMapId);
+		GLState::bindTexture(GL_TEXTURE_CUBE_MAP, envCubeMapId);
 		for (unsigned int i = 0; i < 6; ++i)
 		{
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
@@ -73,8 +74,7 @@ public:
 		equirectToCubemapShader.use();
 		equirectToCubemapShader.setInt("equirectangularMap", 0);
 		equirectToCubemapShader.setMatrix4f("projection", captureProjection);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, hdrTextureId);
+		GLState::bindTexture(0, GL_TEXTURE_2D, hdrTextureId);
 		glViewport(0, 0, 512, 512);
 		for (unsigned int i = 0; i < 6; ++i)
 		{
@@ -83,11 +83,11 @@ public:
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			DrawUtils::DrawUtils::renderCube(cubeVAO, cubeVBO);
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 
 		// Create a convolution of previous cubemap (diffuse irradiance precomputation)
 		glGenTextures(1, &irradianceMapId);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMapId);
+		GLState::bindTexture(GL_TEXTURE_CUBE_MAP, irradianceMapId);
 		for (unsigned int i = 0; i < 6; i++) {
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
 		}
@@ -96,7 +96,7 @@ public:
 		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glBindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
 		glBindRenderbuffer(GL_RENDERBUFFER, envMapRBO);
 		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
 
@@ -104,21 +104,20 @@ public:
 		convolutionShader.use();
 		convolutionShader.setInt("environmentMap", 0);
 		convolutionShader.setMatrix4f("projection", captureProjection);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, envCubeMapId);
+		GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, envCubeMapId);
 		glViewport(0, 0, 32, 32);
-		glBindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
 		for (unsigned int i = 0; i < 6; i++) {
 			convolutionShader.setMatrix4f("view", captureViews[i]);
 			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMapId, 0);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			DrawUtils::renderCube(cubeVAO, cubeVBO);
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 
 		// Setup specular IBL pre-filtered environment map with several roughness levels
 		glGenTextures(1, &prefilterMapId);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMapId);
+		GLState::bindTexture(GL_TEXTURE_CUBE_MAP, prefilterMapId);
 		for (unsigned int i = 0; i < 6; i++) {
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 128, 128, 0, GL_RGB, GL_FLOAT, nullptr);
 		}
@@ -134,10 +133,9 @@ public:
 		prefilterShader.use();
 		prefilterShader.setInt("environmentMap", 0);
 		prefilterShader.setMatrix4f("projection", captureProjection);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, envCubeMapId);
+		GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, envCubeMapId);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
 		// Render prefiltered environment map for several mipmap levels
 		for (unsigned int mip = 0; mip < envMapMipLevels; mip++) {
 			unsigned int mipWidth = 128 * pow(0.5, mip);
@@ -154,19 +152,19 @@ public:
 				DrawUtils::renderCube(cubeVAO, cubeVBO);
 			}
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 
 		// Generate precomputed lookup texture for envmap brdf
 		// a) generate output texture
 		glGenTextures(1, &envLutTexId);
-		glBindTexture(GL_TEXTURE_2D, envLutTexId);
+		GLState::bindTexture(GL_TEXTURE_2D, envLutTexId);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); 
 		// b) compute result
-		glBindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, envMapFBO);
 		glBindRenderbuffer(GL_RENDERBUFFER, envMapRBO);
 		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, envLutTexId, 0);
@@ -177,7 +175,7 @@ public:
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		unsigned int quadVAO {0}, quadVBO {0};
 		DrawUtils::renderQuad(quadVAO, quadVBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
 	void setTextures(Shader &shader)
@@ -194,18 +192,14 @@ public:
 
 	void setUniforms(Shader &shader)
 	{
-		glActiveTexture(GL_TEXTURE11);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMapId);
-		glActiveTexture(GL_TEXTURE12);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMapId);
-		glActiveTexture(GL_TEXTURE13);
-		glBindTexture(GL_TEXTURE_2D, envLutTexId);
+		GLState::bindTexture(11, GL_TEXTURE_CUBE_MAP, irradianceMapId);
+		GLState::bindTexture(12, GL_TEXTURE_CUBE_MAP, prefilterMapId);
+		GLState::bindTexture(13, GL_TEXTURE_2D, envLutTexId);
 	}
 
 	void setEnvMapUniforms(Shader &environmentShader)
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, envCubeMapId);
+		GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, envCubeMapId);
 	}
 
 private:
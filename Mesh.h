@@ -1,15 +1,11 @@
 #pragma once
 
 #include "Shader.h"
+#include "BufferPool.h"
 
+#include <cstdint>
 #include <vector>
 
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texCoords;
-};
-
 struct Texture {
     unsigned int id;
     std::string type;
@@ -20,132 +16,83 @@ const std::string materialUniformName {"material"};
 
 const std::string diffuseTexField     {"diffuseTex"     },
                   specularTexField    {"specularTex"    },
-                  hasDiffuseTexField  {"hasDiffuseTex"  },
-                  hasSpecularTexField {"hasSpecularTex" },
                   ambientColorField   {"ambientColor"   },
                   diffuseColorField   {"diffuseColor"   },
                   specularColorField  {"specularColor"  },
                   shininessField      {"shininess"      };
 
-std::string diffuseTexUniformName,
-            specularTexUniformName,
-            hasDiffuseTexUniformName,
-            hasSpecularTexUniformName,
-            ambientColorUniformName,
-            diffuseColorUniformName,
-            specularColorUniformName,
-            shininessUniformName;
+// Dequantization of compact positions in the vertex shader
+const std::string positionScaleUniformName  {"positionScale" },
+                  positionOffsetUniformName {"positionOffset"};
 
 class Mesh
 {
 public:
     struct Material {
-        glm::vec3 ambientColor;
-        glm::vec3 diffuseColor;
-        glm::vec3 specularColor;
+        glm::vec3 ambientColor {glm::vec3(0.0f)};
+        glm::vec3 diffuseColor {glm::vec3(0.0f)};
+        glm::vec3 specularColor {glm::vec3(0.0f)};
 
         float shininess {100.0f};
     };
 private:
     Material material;
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
+    BufferPool *pool;
+    BufferPool::Allocation allocation;
+    unsigned int indexCount;
+    // GL_UNSIGNED_SHORT whenever the mesh has few enough vertices
+    GLenum indexType;
     std::vector<Texture> textures;
 public:
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures) :
-        vertices(vertices), indices(indices), textures(textures)
+    Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, std::vector<Texture> textures) :
+        Mesh(BufferPool::shared(VertexFormat::Full), vertices.data(), vertices.size(), indices.data(), indices.size(),
+             GL_UNSIGNED_INT, textures) {}
+
+    // Vertices and indices are copied into the pool's buffers, so they may point directly
+    // into a memory-mapped mesh cache. vertices holds Vertex or CompactVertex values depending
+    // on the pool's vertex format. indexType is GL_UNSIGNED_SHORT or GL_UNSIGNED_INT;
+    // 32-bit indices are narrowed on upload when possible.
+    Mesh(BufferPool &pool, const void *vertices, size_t vertexCount, const void *indices, size_t indexCount,
+         GLenum indexType, std::vector<Texture> textures) :
+        pool(&pool), indexCount(indexCount), indexType(indexType), textures(textures)
     {
-        setupMesh();
-
-        // Setup shader material properties
-        std::ostringstream uniformStream;
-        uniformStream << materialUniformName << "." << diffuseTexField;
-        diffuseTexUniformName = uniformStream.str();
-        uniformStream = std::ostringstream();
-        uniformStream << materialUniformName << "." << specularTexField;
-        specularTexUniformName = uniformStream.str();
-        uniformStream = std::ostringstream();
-        uniformStream << materialUniformName << "." << hasDiffuseTexField;
-        hasDiffuseTexUniformName = uniformStream.str();
-        uniformStream = std::ostringstream();
-        uniformStream << materialUniformName << "." << hasSpecularTexField;
-        hasSpecularTexUniformName = uniformStream.str();
-        uniformStream = std::ostringstream();
-        uniformStream << materialUniformName << "." << ambientColorField;
-        ambientColorUniformName = uniformStream.str();
-        uniformStream = std::ostringstream();
-        uniformStream << materialUniformName << "." << diffuseColorField;
-        diffuseColorUniformName = uniformStream.str();
-        uniformStream = std::ostringstream();
-        uniformStream << materialUniformName << "." << specularColorField;
-        specularColorUniformName = uniformStream.str();
-        uniformStream = std::ostringstream();
-        uniformStream << materialUniformName << "." << shininessField;
-        shininessUniformName = uniformStream.str();
+        std::vector<uint16_t> shortIndices;
+        if (indexType == GL_UNSIGNED_INT && fitsShortIndices(vertexCount)) {
+            const unsigned int *longIndices = static_cast<const unsigned int *>(indices);
+            shortIndices.assign(longIndices, longIndices + indexCount);
+            indices = shortIndices.data();
+            this->indexType = GL_UNSIGNED_SHORT;
+        }
+        allocation = pool.allocate(vertices, vertexCount, indices, indexCount * indexSize(this->indexType));
     }
 
     void setMaterial(const Material &mat) { material = mat; }
 
-    void draw(Shader &shader)
+    // Give the buffer ranges back to the pool. Meshes are copied around by value,
+    // so this is left to the owner (see Model).
+    void release() { pool->release(allocation); }
+
+    // Object space position = stored position * scale + offset (identity for VertexFormat::Full)
+    void setPositionTransform(const glm::vec3 &scale, const glm::vec3 &offset)
     {
-        unsigned int diffuseIdx {1}, specularIdx {1};
-
-        shader.setBool(hasDiffuseTexUniformName,  false);
-        shader.setBool(hasSpecularTexUniformName, false);
-
-        for (unsigned int i = 0; i < textures.size(); i++) {
-            glActiveTexture(GL_TEXTURE0 + i + 1);
-            if (textures[i].type == "diffuse") {
-                // i + 1 is because we use texture 0 for shadow mapping
-                shader.setInt(diffuseTexUniformName, i + 1);
-                glBindTexture(GL_TEXTURE_2D, textures[i].id);
-                shader.setBool(hasDiffuseTexUniformName, true);
-            }
-            else if (textures[i].type == "specular") {
-                shader.setInt(specularTexUniformName, i + 1);
-                glBindTexture(GL_TEXTURE_2D, textures[i].id);
-                shader.setBool(hasSpecularTexUniformName, true);
-            }
-        }
-        // Apply material properties
-        shader.setVec3(ambientColorUniformName, material.ambientColor);
-        shader.setVec3(diffuseColorUniformName, material.diffuseColor);
-        shader.setVec3(specularColorUniformName, material.specularColor);
-        shader.setFloat(shininessUniformName, material.shininess);
-
-        // Detach lastly used texture
-        glActiveTexture(GL_TEXTURE0);
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        // Detach verex array after use
-        glBindVertexArray(0);
+        positionScale = scale;
+        positionOffset = offset;
     }
 
+    static bool fitsShortIndices(const size_t &vertexCount) { return vertexCount <= 0xFFFF; }
+    static size_t indexSize(const GLenum &type) { return type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int); }
+
+    // Read by DrawList::compile() to build the mesh's draw packet
+    const Material &getMaterial() const { return material; }
+    const std::vector<Texture> &getTextures() const { return textures; }
+    BufferPool &getPool() const { return *pool; }
+    const BufferPool::Allocation &getAllocation() const { return allocation; }
+    unsigned int getIndexCount() const { return indexCount; }
+    GLenum getIndexType() const { return indexType; }
+    const glm::vec3 &getPositionScale() const { return positionScale; }
+    const glm::vec3 &getPositionOffset() const { return positionOffset; }
+
 private:
-    unsigned int VAO, VBO, EBO;
-private:
-    void setupMesh()
-    {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-
-        // Detach vertex array
-        glBindVertexArray(0);
-    }
+    glm::vec3 positionScale {glm::vec3(1.0f)}, positionOffset {glm::vec3(0.0f)};
 };
@@ -0,0 +1,366 @@
+#pragma once
+
+#include "Mesh.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct TextureRef {
+    std::string type;
+    std::string path;
+};
+
+// CPU-side result of importing one mesh, before any GPU upload
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    // Filled instead of being converted at upload time when the mesh fits 16-bit indices
+    std::vector<uint16_t> shortIndices;
+    // Filled instead of vertices being uploaded when the model uses VertexFormat::Compact
+    std::vector<CompactVertex> compactVertices;
+    glm::vec3 positionScale {glm::vec3(1.0f)}, positionOffset {glm::vec3(0.0f)};
+    Mesh::Material material;
+    std::vector<TextureRef> textures;
+};
+
+// Binary cache of post-processed meshes, stored under Cache/ and keyed by a hash of the
+// source file contents, of the material libraries it references and of the import options.
+// The file is laid out so that vertex and index arrays can be read straight from the mapping
+// without any copy.
+//
+// Layout: Header | per mesh: MeshHeader, Material, texture strings, Vertex[] or CompactVertex[],
+// uint16[] or uint32[]
+// (every block starts on a 4-byte boundary)
+class MeshCache
+{
+public:
+    struct Stats {
+        unsigned int hits {0}, misses {0};
+        double loadMs {0.0}, writeMs {0.0};
+    };
+    static Stats stats;
+    // Models may be read concurrently from loader threads
+    static std::mutex statsMutex;
+
+    // Read-only view over one mesh of a mapped cache file
+    struct MeshView {
+        // Vertex or CompactVertex values, see vertexFormat
+        const void *vertices;
+        uint32_t vertexCount;
+        VertexFormat vertexFormat;
+        glm::vec3 positionScale, positionOffset;
+        // GLushort or GLuint values, see indexType
+        const void *indices;
+        uint32_t indexCount;
+        GLenum indexType;
+        Mesh::Material material;
+        std::vector<TextureRef> textures;
+    };
+
+private:
+    static const std::string baseDir;
+    static constexpr char magic[8] {'O', 'G', 'L', 'M', 'E', 'S', 'H', '\0'};
+    // Bump whenever Vertex, CompactVertex, Mesh::Material or the layout below changes
+    static constexpr uint32_t version {3};
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint64_t sourceHash;
+        uint64_t importKey;
+        uint32_t meshCount;
+        uint32_t padding;
+    };
+
+    struct MeshHeader {
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t textureCount;
+        uint32_t materialSize;
+        uint32_t indexSize;
+        VertexFormat vertexFormat;
+        float positionScale[3];
+        float positionOffset[3];
+    };
+
+    uint64_t sourceHash {0};
+    uint64_t importKey;
+    bool validKey {false};
+    std::string cachePath;
+
+    void *mapping {MAP_FAILED};
+    size_t mappingSize {0};
+    std::vector<MeshView> meshes;
+
+public:
+    // importKey identifies every option that changes the imported data
+    MeshCache(const std::string &sourcePath, const uint64_t &importKey) : importKey(importKey)
+    {
+        validKey = hashFile(sourcePath, sourceHash);
+        if (!validKey) return;
+        // Materials and texture paths are cached too: edited .mtl files must invalidate the entry
+        hashMaterialLibraries(sourcePath, sourceHash);
+
+        std::ostringstream pathStream;
+        pathStream << baseDir << std::hex << std::setw(16) << std::setfill('0') << (sourceHash ^ importKey) << ".mesh";
+        cachePath = pathStream.str();
+    }
+
+    ~MeshCache()
+    {
+        if (mapping != MAP_FAILED)
+            munmap(mapping, mappingSize);
+    }
+
+    MeshCache(const MeshCache &) = delete;
+    MeshCache &operator=(const MeshCache &) = delete;
+
+    // Map the cache file and validate it. Views stay valid as long as this object lives.
+    bool open()
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool hit = validKey && mapFile() && parse();
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if (!hit) {
+            meshes.clear();
+            stats.misses++;
+            return false;
+        }
+        stats.hits++;
+        stats.loadMs += elapsedMs(start);
+        return true;
+    }
+
+    const std::vector<MeshView> &getMeshes() { return meshes; }
+
+    void write(const std::vector<MeshData> &meshData)
+    {
+        if (!validKey) return;
+        auto start = std::chrono::steady_clock::now();
+
+        std::error_code ec;
+        std::filesystem::create_directories(baseDir, ec);
+        // Write to a temporary file first so that a concurrent reader never maps a partial cache
+        std::string tmpPath = cachePath + ".tmp";
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cout << "ERROR::MESH_CACHE::CANNOT_WRITE " << tmpPath << std::endl;
+            return;
+        }
+
+        Header header {};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.importKey = importKey;
+        header.sourceHash = sourceHash;
+        header.meshCount = meshData.size();
+        header.vertexSize = sizeof(Vertex);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        for (const MeshData &mesh : meshData) {
+            MeshHeader meshHeader {};
+            bool isCompact = !mesh.compactVertices.empty();
+            meshHeader.vertexCount = mesh.vertices.size();
+            meshHeader.vertexFormat = isCompact ? VertexFormat::Compact : VertexFormat::Full;
+            for (unsigned int k = 0; k < 3; k++) {
+                meshHeader.positionScale[k] = mesh.positionScale[k];
+                meshHeader.positionOffset[k] = mesh.positionOffset[k];
+            }
+            meshHeader.indexCount = mesh.indices.size();
+            meshHeader.indexSize = mesh.shortIndices.empty() ? sizeof(unsigned int) : sizeof(uint16_t);
+            meshHeader.textureCount = mesh.textures.size();
+            meshHeader.materialSize = sizeof(Mesh::Material);
+            file.write(reinterpret_cast<const char *>(&meshHeader), sizeof(meshHeader));
+            file.write(reinterpret_cast<const char *>(&mesh.material), sizeof(Mesh::Material));
+            for (const TextureRef &texture : mesh.textures) {
+                writeString(file, texture.type);
+                writeString(file, texture.path);
+            }
+            if (isCompact)
+                file.write(reinterpret_cast<const char *>(mesh.compactVertices.data()), mesh.compactVertices.size() * sizeof(CompactVertex));
+            else
+                file.write(reinterpret_cast<const char *>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+            if (mesh.shortIndices.empty())
+                file.write(reinterpret_cast<const char *>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned int));
+            else {
+                file.write(reinterpret_cast<const char *>(mesh.shortIndices.data()), mesh.shortIndices.size() * sizeof(uint16_t));
+                writePadding(file, mesh.shortIndices.size() * sizeof(uint16_t));
+            }
+        }
+        file.close();
+
+        if (file.good())
+            std::filesystem::rename(tmpPath, cachePath, ec);
+        if (!file.good() || ec)
+            std::cout << "ERROR::MESH_CACHE::CANNOT_WRITE " << cachePath << std::endl;
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.writeMs += elapsedMs(start);
+    }
+
+    static void printStats()
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        std::cout << "Mesh cache: " << stats.hits << " hit(s), " << stats.misses << " miss(es), "
+                  << stats.loadMs << " ms loading, " << stats.writeMs << " ms writing" << std::endl;
+    }
+
+    static double elapsedMs(const std::chrono::steady_clock::time_point &start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    static bool hashFile(const std::string &path, uint64_t &hash, const uint64_t &seed = Hash::fnvOffsetBasis)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        hash = seed;
+        char buffer[1 << 16];
+        while (file) {
+            file.read(buffer, sizeof(buffer));
+            hash = Hash::fnv1a(buffer, file.gcount(), hash);
+        }
+        return true;
+    }
+
+    // Folds the contents of the mtllib files of an OBJ model into hash, as Assimp resolves
+    // them (relative to the model directory). Missing libraries are folded in by name, so
+    // that adding one later changes the key as well. Other formats embed their materials.
+    static void hashMaterialLibraries(const std::string &sourcePath, uint64_t &hash)
+    {
+        std::filesystem::path path(sourcePath);
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension != ".obj") return;
+
+        std::ifstream file(sourcePath);
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line.compare(start, 7, "mtllib ") != 0) continue;
+            std::istringstream names(line.substr(start + 7));
+            std::string name;
+            while (names >> name) {
+                std::string libraryPath = (path.parent_path() / name).string();
+                hash = Hash::fnv1a(libraryPath.data(), libraryPath.size(), hash);
+                uint64_t libraryHash;
+                if (hashFile(libraryPath, libraryHash, hash)) hash = libraryHash;
+            }
+        }
+    }
+
+    static void writeString(std::ofstream &file, const std::string &str)
+    {
+        uint32_t length = str.size();
+        file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        file.write(str.data(), length);
+        writePadding(file, length);
+    }
+
+    // Keep next block 4-byte aligned
+    static void writePadding(std::ofstream &file, const size_t &blockSize)
+    {
+        static const char padding[4] {};
+        file.write(padding, (4 - blockSize % 4) % 4);
+    }
+
+    bool mapFile()
+    {
+        int fd = ::open(cachePath.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size >= (off_t)sizeof(Header)) {
+            mappingSize = fileStat.st_size;
+            mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+        return mapping != MAP_FAILED;
+    }
+
+    bool parse()
+    {
+        const char *data = static_cast<const char *>(mapping);
+        const char *end = data + mappingSize;
+
+        Header header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version
+            || header.importKey != importKey || header.sourceHash != sourceHash
+            || header.vertexSize != sizeof(Vertex))
+            return false;
+
+        const char *cursor = data + sizeof(Header);
+        for (uint32_t i = 0; i < header.meshCount; i++) {
+            MeshHeader meshHeader;
+            if (end - cursor < (ptrdiff_t)(sizeof(MeshHeader) + sizeof(Mesh::Material))) return false;
+            std::memcpy(&meshHeader, cursor, sizeof(meshHeader));
+            cursor += sizeof(MeshHeader);
+            if (meshHeader.materialSize != sizeof(Mesh::Material)) return false;
+
+            MeshView view;
+            std::memcpy(&view.material, cursor, sizeof(Mesh::Material));
+            cursor += sizeof(Mesh::Material);
+            for (uint32_t t = 0; t < meshHeader.textureCount; t++) {
+                TextureRef texture;
+                if (!readString(cursor, end, texture.type) || !readString(cursor, end, texture.path))
+                    return false;
+                view.textures.push_back(texture);
+            }
+
+            if (meshHeader.vertexFormat != VertexFormat::Full && meshHeader.vertexFormat != VertexFormat::Compact) return false;
+            size_t vertexBytes = meshHeader.vertexCount * vertexSize(meshHeader.vertexFormat);
+            if (meshHeader.indexSize != sizeof(uint16_t) && meshHeader.indexSize != sizeof(unsigned int)) return false;
+            size_t indexBytes = meshHeader.indexCount * meshHeader.indexSize;
+            indexBytes += (4 - indexBytes % 4) % 4;
+            if ((size_t)(end - cursor) < vertexBytes + indexBytes) return false;
+            view.vertices = cursor;
+            view.vertexCount = meshHeader.vertexCount;
+            view.vertexFormat = meshHeader.vertexFormat;
+            view.positionScale = glm::vec3(meshHeader.positionScale[0], meshHeader.positionScale[1], meshHeader.positionScale[2]);
+            view.positionOffset = glm::vec3(meshHeader.positionOffset[0], meshHeader.positionOffset[1], meshHeader.positionOffset[2]);
+            cursor += vertexBytes;
+            view.indices = cursor;
+            view.indexCount = meshHeader.indexCount;
+            view.indexType = meshHeader.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            cursor += indexBytes;
+
+            meshes.push_back(view);
+        }
+        return true;
+    }
+
+    static bool readString(const char *&cursor, const char *end, std::string &str)
+    {
+        uint32_t length;
+        if (end - cursor < (ptrdiff_t)sizeof(length)) return false;
+        std::memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        size_t padded = length + (4 - length % 4) % 4;
+        if ((size_t)(end - cursor) < padded) return false;
+        str.assign(cursor, length);
+        cursor += padded;
+        return true;
+    }
+};
+
+MeshCache::Stats MeshCache::stats;
+std::mutex MeshCache::statsMutex;
+const std::string MeshCache::baseDir {"Cache/"};
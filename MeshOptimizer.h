@@ -0,0 +1,356 @@
+#pragma once
+
+#include "Vertex.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+// Import-time processing of mesh indices and vertices for the GPU:
+// - vertex welding (merge duplicated vertices),
+// - vertex cache reordering with Tipsify (Sander, Nehab & Barczak, "Fast Triangle Reordering
+//   for Vertex Locality and Reduced Overdraw", 2007),
+// - overdraw-aware sorting of the clusters produced by Tipsify (outward facing clusters first),
+// - vertex fetch remapping (vertices stored in the order they are first referenced),
+// - quantization to the CompactVertex layout.
+namespace MeshOptimizer
+{
+    // Size of the simulated post-transform FIFO cache
+    const unsigned int cacheSize {16};
+
+    struct Stats {
+        float acmrBefore, acmrAfter;
+        float atvrBefore, atvrAfter;
+    };
+
+    // Cell of an epsilon-sized grid holding value, computed in 64 bits and clamped so that the
+    // conversion stays defined for tiny epsilons, huge coordinates and NaNs
+    inline int64_t gridCell(const float &value, const float &epsilon)
+    {
+        const double maxCell {double(1ll << 60)};
+        double cell = std::floor((double)value / epsilon);
+        if (!(cell == cell)) return 0;
+        return (int64_t)std::min(std::max(cell, -maxCell), maxCell);
+    }
+
+    // Merges vertices whose attributes are all bitwise equal (epsilon == 0) or all within
+    // epsilon of a vertex kept before them (epsilon > 0). Positions are bucketed in an
+    // epsilon-sized grid and the 27 cells around each vertex are searched, so that close
+    // vertices on both sides of a cell boundary are merged too. Returns the number of
+    // vertices removed.
+    inline size_t weldVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, const float &epsilon)
+    {
+        static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex is expected to hold 8 floats");
+        using Key = std::array<int32_t, 8>;
+        using Cell = std::array<int64_t, 3>;
+        struct KeyHash {
+            size_t operator()(const Key &key) const { return Hash::fnv1a(key.data(), sizeof(Key)); }
+            size_t operator()(const Cell &cell) const { return Hash::fnv1a(cell.data(), sizeof(Cell)); }
+        };
+
+        std::unordered_map<Key, unsigned int, KeyHash> uniqueVertices;
+        // Kept vertices by position cell, epsilon > 0 only
+        std::unordered_map<Cell, std::vector<unsigned int>, KeyHash> cells;
+        if (epsilon > 0.0f) cells.reserve(vertices.size());
+        else uniqueVertices.reserve(vertices.size());
+        std::vector<unsigned int> remap(vertices.size());
+        std::vector<Vertex> welded;
+        welded.reserve(vertices.size());
+
+        auto isClose = [&epsilon](const Vertex &a, const Vertex &b) {
+            float first[8], second[8];
+            std::memcpy(first, &a, sizeof(first));
+            std::memcpy(second, &b, sizeof(second));
+            for (unsigned int k = 0; k < 8; k++)
+                if (!(std::fabs(first[k] - second[k]) <= epsilon)) return false;
+            return true;
+        };
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex &vertex = vertices[i];
+            if (epsilon > 0.0f) {
+                Cell cell {gridCell(vertex.position[0], epsilon), gridCell(vertex.position[1], epsilon),
+                           gridCell(vertex.position[2], epsilon)};
+                bool found {false};
+                for (int64_t dx = -1; dx <= 1 && !found; dx++)
+                    for (int64_t dy = -1; dy <= 1 && !found; dy++)
+                        for (int64_t dz = -1; dz <= 1 && !found; dz++) {
+                            auto it = cells.find({cell[0] + dx, cell[1] + dy, cell[2] + dz});
+                            if (it == cells.end()) continue;
+                            for (unsigned int candidate : it->second)
+                                if (isClose(vertex, welded[candidate])) {
+                                    remap[i] = candidate;
+                                    found = true;
+                                    break;
+                                }
+                        }
+                if (found) continue;
+                remap[i] = welded.size();
+                cells[cell].push_back(welded.size());
+                welded.push_back(vertex);
+                continue;
+            }
+
+            float attributes[8];
+            std::memcpy(attributes, &vertex, sizeof(attributes));
+            Key key;
+            for (unsigned int k = 0; k < 8; k++) {
+                // Make 0.0 and -0.0 compare equal
+                float value = attributes[k] == 0.0f ? 0.0f : attributes[k];
+                std::memcpy(&key[k], &value, sizeof(float));
+            }
+            auto inserted = uniqueVertices.emplace(key, (unsigned int)welded.size());
+            if (inserted.second)
+                welded.push_back(vertex);
+            remap[i] = inserted.first->second;
+        }
+
+        for (unsigned int &index : indices)
+            index = remap[index];
+        size_t removed = vertices.size() - welded.size();
+        vertices.swap(welded);
+        return removed;
+    }
+
+    // Returns the number of vertices transformed with a FIFO cache of the given size
+    inline size_t simulateCache(const std::vector<unsigned int> &indices, const size_t &vertexCount, const unsigned int &size = cacheSize)
+    {
+        std::vector<size_t> insertedAt(vertexCount, 0);
+        size_t transformed {0};
+        for (unsigned int index : indices) {
+            // A vertex is still cached if less than 'size' vertices were inserted since it was
+            if (insertedAt[index] == 0 || transformed - (insertedAt[index] - 1) >= size) {
+                transformed++;
+                insertedAt[index] = transformed;
+            }
+        }
+        return transformed;
+    }
+
+    // Average cache miss ratio: transformed vertices per triangle (0.5 at best, 3 at worst)
+    inline float computeACMR(const std::vector<unsigned int> &indices, const size_t &vertexCount)
+    {
+        if (indices.empty()) return 0.0f;
+        return simulateCache(indices, vertexCount) / (float)(indices.size() / 3);
+    }
+
+    // Average transform to vertex ratio: transformed vertices per mesh vertex (1 at best)
+    inline float computeATVR(const std::vector<unsigned int> &indices, const size_t &vertexCount)
+    {
+        if (vertexCount == 0) return 0.0f;
+        return simulateCache(indices, vertexCount) / (float)vertexCount;
+    }
+
+    // Reorders triangles for vertex cache locality. clusterStarts receives the index (in
+    // triangles) at which each cluster begins; clusters are cut where Tipsify had to
+    // restart from a vertex which is not in cache anymore.
+    inline std::vector<unsigned int> tipsify(const std::vector<unsigned int> &indices, const size_t &vertexCount,
+                                             std::vector<size_t> &clusterStarts)
+    {
+        const size_t triangleCount = indices.size() / 3;
+
+        // Vertex -> triangles adjacency, in compressed form
+        std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+        for (unsigned int index : indices)
+            adjacencyOffsets[index + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        std::vector<unsigned int> adjacency(indices.size());
+        std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = i / 3;
+
+        std::vector<unsigned int> liveTriangles(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+
+        std::vector<size_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<unsigned int> deadEnd;
+        std::vector<unsigned int> candidates;
+        std::vector<unsigned int> output;
+        output.reserve(indices.size());
+
+        size_t time = cacheSize + 1;
+        size_t cursor = 0;
+        long fanning = triangleCount > 0 ? indices[0] : -1;
+        clusterStarts.assign(1, 0);
+
+        while (fanning >= 0) {
+            candidates.clear();
+            for (unsigned int a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+                unsigned int t = adjacency[a];
+                if (emitted[t]) continue;
+                for (unsigned int k = 0; k < 3; k++) {
+                    unsigned int v = indices[3 * t + k];
+                    output.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    liveTriangles[v]--;
+                    if (time - cacheTime[v] > cacheSize)
+                        cacheTime[v] = time++;
+                }
+                emitted[t] = true;
+            }
+
+            // Next fanning vertex: the candidate which will stay in cache the longest
+            long next = -1;
+            size_t bestPriority = 0;
+            for (unsigned int v : candidates) {
+                if (liveTriangles[v] == 0) continue;
+                size_t priority = 0;
+                if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                    priority = time - cacheTime[v];
+                if (next < 0 || priority > bestPriority) {
+                    bestPriority = priority;
+                    next = v;
+                }
+            }
+            if (next >= 0) {
+                fanning = next;
+                continue;
+            }
+
+            // Dead end: go back to recently used vertices, then scan for any vertex left
+            while (!deadEnd.empty() && next < 0) {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0) next = v;
+            }
+            while (next < 0 && cursor < vertexCount) {
+                if (liveTriangles[cursor] > 0) next = cursor;
+                cursor++;
+            }
+            if (next >= 0 && output.size() < indices.size())
+                clusterStarts.push_back(output.size() / 3);
+            fanning = next;
+        }
+        return output;
+    }
+
+    // Sorts clusters so that the ones facing away from the mesh center are drawn first,
+    // which tends to occlude the others early
+    inline std::vector<unsigned int> reorderForOverdraw(const std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices,
+                                                        const std::vector<size_t> &clusterStarts)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (clusterStarts.size() < 2) return indices;
+
+        glm::vec3 meshCenter(0.0f);
+        float meshArea {0.0f};
+        struct Cluster { size_t begin, end; float sortKey; };
+        std::vector<Cluster> clusters;
+        std::vector<glm::vec3> centers;
+        std::vector<glm::vec3> normals;
+
+        for (size_t c = 0; c < clusterStarts.size(); c++) {
+            Cluster cluster {clusterStarts[c], c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount, 0.0f};
+            glm::vec3 center(0.0f), normal(0.0f);
+            float area {0.0f};
+            for (size_t t = cluster.begin; t < cluster.end; t++) {
+                const glm::vec3 &p0 = vertices[indices[3 * t]].position;
+                const glm::vec3 &p1 = vertices[indices[3 * t + 1]].position;
+                const glm::vec3 &p2 = vertices[indices[3 * t + 2]].position;
+                // Cross product length is twice the triangle area
+                glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+                float faceArea = glm::length(faceNormal);
+                center += (p0 + p1 + p2) * (faceArea / 3.0f);
+                normal += faceNormal;
+                area += faceArea;
+            }
+            meshCenter += center;
+            meshArea += area;
+            centers.push_back(area > 0.0f ? center / area : vertices[indices[3 * cluster.begin]].position);
+            normals.push_back(glm::length(normal) > 0.0f ? glm::normalize(normal) : normal);
+            clusters.push_back(cluster);
+        }
+        if (meshArea > 0.0f) meshCenter /= meshArea;
+
+        for (size_t c = 0; c < clusters.size(); c++)
+            clusters[c].sortKey = glm::dot(centers[c] - meshCenter, normals[c]);
+        std::stable_sort(clusters.begin(), clusters.end(),
+                         [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+        std::vector<unsigned int> output;
+        output.reserve(indices.size());
+        for (const Cluster &cluster : clusters)
+            output.insert(output.end(), indices.begin() + 3 * cluster.begin, indices.begin() + 3 * cluster.end);
+        return output;
+    }
+
+    // Stores vertices in the order they are first used by the index buffer and drops unused ones
+    inline void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        const unsigned int unused = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), unused);
+        std::vector<Vertex> remapped;
+        remapped.reserve(vertices.size());
+        for (unsigned int &index : indices) {
+            if (remap[index] == unused) {
+                remap[index] = remapped.size();
+                remapped.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(remapped);
+    }
+
+    inline Stats optimize(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        Stats stats;
+        stats.acmrBefore = computeACMR(indices, vertices.size());
+        stats.atvrBefore = computeATVR(indices, vertices.size());
+
+        std::vector<size_t> clusterStarts;
+        indices = tipsify(indices, vertices.size(), clusterStarts);
+        indices = reorderForOverdraw(indices, vertices, clusterStarts);
+        optimizeVertexFetch(vertices, indices);
+
+        stats.acmrAfter = computeACMR(indices, vertices.size());
+        stats.atvrAfter = computeATVR(indices, vertices.size());
+        return stats;
+    }
+
+    // Packs vertices into the compact layout. Positions are quantized over the mesh bounds,
+    // which are returned as the scale/offset to apply in the vertex shader.
+    inline std::vector<CompactVertex> quantizeVertices(const std::vector<Vertex> &vertices, glm::vec3 &positionScale, glm::vec3 &positionOffset)
+    {
+        glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+        if (!vertices.empty()) boundsMin = boundsMax = vertices[0].position;
+        for (const Vertex &vertex : vertices) {
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
+        }
+        positionOffset = boundsMin;
+        positionScale = boundsMax - boundsMin;
+
+        std::vector<CompactVertex> compact(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex &vertex = vertices[i];
+            CompactVertex &packed = compact[i];
+            for (unsigned int k = 0; k < 3; k++) {
+                float t = positionScale[k] > 0.0f ? (vertex.position[k] - boundsMin[k]) / positionScale[k] : 0.0f;
+                packed.position[k] = (uint16_t)std::lround(glm::clamp(t, 0.0f, 1.0f) * 65535.0f);
+            }
+            packed.position[3] = 0;
+
+            glm::vec3 normal = glm::length(vertex.normal) > 0.0f ? glm::normalize(vertex.normal) : vertex.normal;
+            packed.normal = 0;
+            for (unsigned int k = 0; k < 3; k++) {
+                int32_t component = std::lround(glm::clamp(normal[k], -1.0f, 1.0f) * 511.0f);
+                packed.normal |= ((uint32_t)component & 0x3FF) << (10 * k);
+            }
+
+            packed.texCoords[0] = glm::packHalf1x16(vertex.texCoords[0]);
+            packed.texCoords[1] = glm::packHalf1x16(vertex.texCoords[1]);
+        }
+        return compact;
+    }
+}
@@ -1,6 +1,16 @@
 #pragma once
 
+#include "BufferPool.h"
+#include "DrawList.h"
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include "TextureRegistry.h"
+
+#include <atomic>
+#include <limits>
+#include <unordered_map>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -8,26 +18,276 @@
 #define STB_IMAGE_IMPLEMENTATION ;
 #include "stb_image.h"
 
+struct TextureImage {
+    std::string path;
+    uint64_t contentHash {0};
+    // Left empty when the registry already holds a texture with the same content
+    unsigned char *data {nullptr};
+    // That texture then, with a reference taken when decoding was skipped
+    unsigned int sharedId {0};
+    int width {0}, height {0}, nrComponents {0};
+    // Time spent decoding, on the worker thread
+    double decodeMs {0.0};
+};
+
+TextureImage decodeTexture(const std::string &path, const bool &acquireShared = true);
+unsigned int uploadTexture(TextureImage &image);
 unsigned int loadTexture(const char *path, const std::string &dir);
 
+// Processing applied to meshes on import (the result is what gets cached)
+struct ModelImportOptions {
+    // Merge duplicated vertices, either exactly equal or closer than weldEpsilon
+    bool weldVertices {true};
+    float weldEpsilon {0.0f};
+    // Vertex cache, overdraw and vertex fetch reordering, see MeshOptimizer
+    bool optimizeMeshes {true};
+    // Compact halves vertex memory and fetch bandwidth at the cost of some precision
+    VertexFormat vertexFormat {VertexFormat::Full};
+};
+
 class Model
 {
 public:
-    Model(const std::string &path)
+    using ImportOptions = ModelImportOptions;
+
+    // Blocking load, on the thread owning the GL context
+    Model(const std::string &path, const ImportOptions &options = ImportOptions())
     {
-        loadModel(path);
+        if (read(path, options)) {
+            decodeTextures();
+            upload(std::numeric_limits<double>::infinity());
+        }
     }
 
-    void draw(Shader &shader)
+    // Empty model, to be filled step by step (see ModelLoader)
+    Model() {}
+
+    ~Model()
     {
+        // References taken by decoding for textures that were never uploaded
+        if (pending)
+            for (unsigned int i = pending->uploadedTextures; i < pending->textures.size(); i++)
+                if (pending->textures[i].sharedId != 0) TextureRegistry::instance().release(pending->textures[i].sharedId);
+        for (const DrawPacket &packet : packets)
+            DrawList::release(packet);
         for (Mesh &mesh : meshes)
-            mesh.draw(shader);
+            mesh.release();
+        for (const auto &loaded : loadedTextures)
+            TextureRegistry::instance().release(loaded.second.id);
+    }
+
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    // Queue every mesh for drawing with the permutation matching its packet; the list sorts
+    // and issues the draws
+    void submit(DrawList &drawList, ShaderPermutations &shaders)
+    {
+        for (const DrawPacket &packet : packets)
+            drawList.submit(packet, shaders, modelMat);
+    }
+
+    // Loading steps. read() and decodeTextures() make no GL call and may run on a
+    // background thread; upload() must run on the GL thread.
+
+    bool read(const std::string &path, const ImportOptions &options = ImportOptions())
+    {
+        CPU_PROFILE_SCOPE("Model::read");
+        auto start = std::chrono::steady_clock::now();
+        pending = std::make_unique<PendingData>();
+        pending->path = path;
+        dir = path.substr(0, path.find_last_of('/'));
+
+        // Warm start: meshes are uploaded straight from the mapped cache, without Assimp
+        pending->cache = std::make_unique<MeshCache>(path, importKey(options));
+        if (pending->cache->open()) {
+            pending->meshes = pending->cache->getMeshes();
+            std::cout << "Model " << path << " read from cache in " << MeshCache::elapsedMs(start) << " ms" << std::endl;
+        }
+        else {
+            Assimp::Importer importer;
+            const aiScene *scene = importer.ReadFile(path, importFlags);
+
+            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+                std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+                pending.reset();
+                return false;
+            }
+            processNode(scene->mRootNode, scene, pending->imported);
+            processMeshes(pending->imported, options);
+            for (const MeshData &mesh : pending->imported) {
+                bool isShort = !mesh.shortIndices.empty();
+                bool isCompact = !mesh.compactVertices.empty();
+                pending->meshes.push_back({isCompact ? (const void *)mesh.compactVertices.data() : mesh.vertices.data(),
+                                           (uint32_t)mesh.vertices.size(), isCompact ? VertexFormat::Compact : VertexFormat::Full,
+                                           mesh.positionScale, mesh.positionOffset,
+                                           isShort ? (const void *)mesh.shortIndices.data() : mesh.indices.data(),
+                                           (uint32_t)mesh.indices.size(), isShort ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                                           mesh.material, mesh.textures});
+            }
+            std::cout << "Model " << path << " imported in " << MeshCache::elapsedMs(start) << " ms" << std::endl;
+            pending->cache->write(pending->imported);
+        }
+        MeshCache::printStats();
+
+        boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const MeshCache::MeshView &mesh : pending->meshes) {
+            // Compact positions are quantized over the mesh bounds
+            if (mesh.vertexFormat == VertexFormat::Compact) {
+                boundsMin = glm::min(boundsMin, mesh.positionOffset);
+                boundsMax = glm::max(boundsMax, mesh.positionOffset + mesh.positionScale);
+                continue;
+            }
+            const Vertex *vertices = static_cast<const Vertex *>(mesh.vertices);
+            for (uint32_t i = 0; i < mesh.vertexCount; i++) {
+                boundsMin = glm::min(boundsMin, vertices[i].position);
+                boundsMax = glm::max(boundsMax, vertices[i].position);
+            }
+        }
+        hasBounds.store(!pending->meshes.empty(), std::memory_order_release);
+        workTotal += pending->meshes.size();
+        return true;
+    }
+
+    // Take every texture already known to the registry and decode the other ones on the
+    // shared worker pool. Returns once every decode is done: results are collected in
+    // submission order, and upload() later sends them to the GL in that same order, so
+    // no upload starts before the slowest decode has finished.
+    void decodeTextures()
+    {
+        CPU_PROFILE_SCOPE("Model::decodeTextures");
+        if (!pending) return;
+        auto start = std::chrono::steady_clock::now();
+        TextureRegistry &registry = TextureRegistry::instance();
+
+        std::vector<std::future<TextureImage>> decoding;
+        for (const MeshCache::MeshView &mesh : pending->meshes) {
+            for (const TextureRef &ref : mesh.textures) {
+                if (loadedTextures.count(ref.path) > 0) continue;
+
+                std::string path = TextureRegistry::canonicalPath(dir + '/' + textureFilename(ref.path));
+                unsigned int id = registry.acquireByPath(path);
+                // A zero id reserves the entry so that a texture used by several meshes is only queued once
+                loadedTextures[ref.path] = {id, ref.type, ref.path};
+                if (id != 0) {
+                    pending->sharedTextures++;
+                    continue;
+                }
+                decoding.push_back(ThreadPool::shared().submit([path] { return decodeTexture(path); }));
+                pending->textureRefs.push_back(ref);
+                pending->texturePaths.push_back(path);
+            }
+        }
+        workTotal += 2 * decoding.size();
+
+        for (std::future<TextureImage> &image : decoding) {
+            pending->textures.push_back(image.get());
+            pending->decodeMs += pending->textures.back().decodeMs;
+            workDone++;
+        }
+        pending->decodeWallMs = MeshCache::elapsedMs(start);
+    }
+
+    // Upload decoded textures then meshes until the time budget is spent. Returns true once
+    // the model is complete.
+    bool upload(const double &budgetMs)
+    {
+        CPU_PROFILE_SCOPE("Model::upload");
+        if (!pending) return true;
+        auto start = std::chrono::steady_clock::now();
+        TextureRegistry &registry = TextureRegistry::instance();
+
+        while (pending->uploadedTextures < pending->textures.size()) {
+            if (MeshCache::elapsedMs(start) > budgetMs) return false;
+            unsigned int i = pending->uploadedTextures++;
+            TextureImage &image = pending->textures[i];
+
+            auto uploadStart = std::chrono::steady_clock::now();
+            // Either decoding found the image already on the GPU and kept a reference to it, or
+            // another model (or another path of this one) may have uploaded it meanwhile
+            unsigned int id = image.sharedId;
+            bool decoded = image.data != nullptr;
+            if (id == 0 && decoded) id = registry.acquireByContent(pending->texturePaths[i], image.contentHash);
+            if (id == 0) {
+                id = uploadTexture(image);
+                registry.add(pending->texturePaths[i], image.contentHash, id, decoded);
+            }
+            else {
+                stbi_image_free(image.data);
+                image.data = nullptr;
+                pending->sharedTextures++;
+            }
+            loadedTextures[pending->textureRefs[i].path].id = id;
+            pending->uploadMs += MeshCache::elapsedMs(uploadStart);
+            workDone++;
+        }
+
+        while (meshes.size() < pending->meshes.size()) {
+            if (MeshCache::elapsedMs(start) > budgetMs) return false;
+            const MeshCache::MeshView &view = pending->meshes[meshes.size()];
+            createMesh(view);
+            workDone++;
+        }
+        if (bufferPool) bufferPool->printStats();
+        // Meshes no longer move: their packets can be compiled
+        for (const Mesh &mesh : meshes)
+            packets.push_back(DrawList::compile(mesh));
+
+        std::cout << "Model " << pending->path << ": " << meshes.size() << " meshes, textures "
+                  << pending->sharedTextures << " shared, " << pending->textures.size() << " decoded in "
+                  << pending->decodeWallMs << " ms (" << pending->decodeMs << " ms summed over "
+                  << ThreadPool::shared().size() << " threads), " << pending->uploadMs << " ms uploading, "
+                  << TextureRegistry::instance().size() << " in registry" << std::endl;
+        pending.reset();
+        return true;
+    }
+
+    // Fraction of the loading work done so far (safe to call from any thread)
+    float getProgress()
+    {
+        unsigned int total = workTotal;
+        return total == 0 ? 0.0f : workDone / (float)total;
+    }
+
+    // Object space bounding box, known once read() succeeded
+    bool getBounds(glm::vec3 &min, glm::vec3 &max)
+    {
+        // Written by the loader thread before hasBounds is published
+        if (!hasBounds.load(std::memory_order_acquire)) return false;
+        min = boundsMin;
+        max = boundsMax;
+        return true;
     }
 
 private:
     std::vector<Mesh> meshes;
+    // One per mesh, in the same order
+    std::vector<DrawPacket> packets;
+    // Pool holding the buffers of every mesh above, depending on their vertex format
+    BufferPool *bufferPool {nullptr};
     std::string dir;
-    std::vector<Texture> loadedTextures;
+    // Textures referenced by this model, by material path. Each holds one registry reference.
+    std::unordered_map<std::string, Texture> loadedTextures;
+
+    // CPU-side data kept between loading steps
+    struct PendingData {
+        std::string path;
+        // Keeps the mapped views alive on a warm start
+        std::unique_ptr<MeshCache> cache;
+        std::vector<MeshData> imported;
+        std::vector<MeshCache::MeshView> meshes;
+        std::vector<TextureRef> textureRefs;
+        std::vector<std::string> texturePaths;
+        std::vector<TextureImage> textures;
+        unsigned int uploadedTextures {0}, sharedTextures {0};
+        double decodeMs {0.0}, decodeWallMs {0.0}, uploadMs {0.0};
+    };
+    std::unique_ptr<PendingData> pending;
+    std::atomic<unsigned int> workDone {0}, workTotal {0};
+
+    glm::vec3 boundsMin {glm::vec3(0.0f)}, boundsMax {glm::vec3(0.0f)};
+    std::atomic<bool> hasBounds {false};
 
     glm::mat4 modelMat {glm::mat4(1.0f)};
     glm::vec3 position {glm::vec3(0.0f)},
@@ -36,35 +296,83 @@ private:
     float rotationAngleDegrees {0.0f};
 
 private:
-    void loadModel(const std::string &path)
+    static constexpr unsigned int importFlags {aiProcess_Triangulate | aiProcess_FlipUVs};
+    // Our own processing steps, stored in the cache key next to the Assimp flags (which
+    // leave the highest bits unused)
+    static constexpr unsigned int optimizedMeshesFlag {1u << 31};
+    static constexpr unsigned int weldedVerticesFlag {1u << 30};
+
+    static uint64_t importKey(const ImportOptions &options)
     {
-        Assimp::Importer importer;
-        const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+        unsigned int flags = importFlags;
+        if (options.optimizeMeshes) flags |= optimizedMeshesFlag;
+        if (options.weldVertices) flags |= weldedVerticesFlag;
+        uint64_t key = Hash::fnv1a(&flags, sizeof(flags));
+        key = Hash::fnv1a(&options.vertexFormat, sizeof(options.vertexFormat), key);
+        if (options.weldVertices)
+            key = Hash::fnv1a(&options.weldEpsilon, sizeof(options.weldEpsilon), key);
+        return key;
+    }
 
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-            std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-            return;
+    // Welding, reordering, index narrowing and quantization of freshly imported meshes, one job per mesh
+    static void processMeshes(std::vector<MeshData> &meshData, const ImportOptions &options)
+    {
+        CPU_PROFILE_SCOPE("Model::processMeshes");
+        auto start = std::chrono::steady_clock::now();
+        size_t vertexBytesBefore {0}, indexBytesBefore {0}, vertexBytesAfter {0}, indexBytesAfter {0};
+        for (const MeshData &mesh : meshData) {
+            vertexBytesBefore += mesh.vertices.size() * sizeof(Vertex);
+            indexBytesBefore += mesh.indices.size() * sizeof(unsigned int);
         }
-        dir = path.substr(0, path.find_last_of('/'));
-        processNode(scene->mRootNode, scene);
+
+        std::vector<std::future<MeshOptimizer::Stats>> processing;
+        for (MeshData &mesh : meshData) {
+            processing.push_back(ThreadPool::shared().submit([&mesh, options] {
+                CPU_PROFILE_SCOPE("Optimize mesh");
+                if (options.weldVertices)
+                    MeshOptimizer::weldVertices(mesh.vertices, mesh.indices, options.weldEpsilon);
+                MeshOptimizer::Stats stats {};
+                if (options.optimizeMeshes)
+                    stats = MeshOptimizer::optimize(mesh.vertices, mesh.indices);
+                if (Mesh::fitsShortIndices(mesh.vertices.size()))
+                    mesh.shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+                if (options.vertexFormat == VertexFormat::Compact)
+                    mesh.compactVertices = MeshOptimizer::quantizeVertices(mesh.vertices, mesh.positionScale, mesh.positionOffset);
+                return stats;
+            }));
+        }
+
+        for (unsigned int i = 0; i < processing.size(); i++) {
+            MeshOptimizer::Stats stats = processing[i].get();
+            const MeshData &mesh = meshData[i];
+            vertexBytesAfter += mesh.vertices.size() * vertexSize(options.vertexFormat);
+            indexBytesAfter += mesh.indices.size() * (mesh.shortIndices.empty() ? sizeof(unsigned int) : sizeof(uint16_t));
+            if (options.optimizeMeshes)
+                std::cout << "Mesh " << i << " (" << mesh.indices.size() / 3 << " triangles): ACMR "
+                          << stats.acmrBefore << " -> " << stats.acmrAfter << ", ATVR "
+                          << stats.atvrBefore << " -> " << stats.atvrAfter << std::endl;
+        }
+        std::cout << "Processed " << meshData.size() << " meshes in " << MeshCache::elapsedMs(start) << " ms: vertices "
+                  << vertexBytesBefore << " -> " << vertexBytesAfter << " bytes, indices "
+                  << indexBytesBefore << " -> " << indexBytesAfter << " bytes" << std::endl;
     }
 
-    void processNode(const aiNode *node, const aiScene *scene)
+    void processNode(const aiNode *node, const aiScene *scene, std::vector<MeshData> &meshData)
     {
         for (unsigned int i = 0; i < node->mNumMeshes; i++) {
             aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshData.push_back(processMesh(mesh, scene));
         }
         for (unsigned int i = 0; i < node->mNumChildren; i++) {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, meshData);
         }
     }
 
-    Mesh processMesh(const aiMesh *mesh, const aiScene *scene)
+    MeshData processMesh(const aiMesh *mesh, const aiScene *scene)
     {
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
-        std::vector<Texture> textures;
+        MeshData data;
+        std::vector<Vertex> &vertices = data.vertices;
+        std::vector<unsigned int> &indices = data.indices;
 
         for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
             Vertex v;
@@ -93,7 +401,7 @@ private:
                 indices.push_back(face.mIndices[j]);
         }
 
-        Mesh::Material meshMaterial;
+        Mesh::Material &meshMaterial = data.material;
         if (mesh->mMaterialIndex >= 0) {
             aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
 
@@ -110,48 +418,46 @@ private:
             if (aiGetMaterialColor(material, AI_MATKEY_COLOR_SPECULAR, &specular) == AI_SUCCESS)
                 meshMaterial.specularColor = glm::vec3(specular.r, specular.g, specular.b);
             
-            std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "diffuse");
-            textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-            std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "specular");
-            textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+            getMaterialTextures(material, aiTextureType_DIFFUSE, "diffuse", data.textures);
+            getMaterialTextures(material, aiTextureType_SPECULAR, "specular", data.textures);
         }
 
-        Mesh meshObj(vertices, indices, textures);
-        meshObj.setMaterial(meshMaterial);
-
-        return meshObj;
+        return data;
     }
 
-    std::vector<Texture> loadMaterialTextures(const aiMaterial *mat, const aiTextureType &type, const std::string &typeName)
+    void getMaterialTextures(const aiMaterial *mat, const aiTextureType &type, const std::string &typeName, std::vector<TextureRef> &textures)
     {
-        std::vector<Texture> textures;
         for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
             aiString str;
             mat->GetTexture(type, i, &str);
+            textures.push_back({typeName, str.C_Str()});
+        }
+    }
 
-            bool skip = false;
-            // First check if current texture has already been loaded from the path name
-            for (unsigned int j = 0; j < loadedTextures.size(); j++) {
-                if (std::strcmp(loadedTextures[j].path.data(), str.C_Str()) == 0) {
-                    textures.push_back(loadedTextures[j]);
-                    skip = true;
-                    break;
-                }
-            }
-            if (skip) continue;
+    void createMesh(const MeshCache::MeshView &view)
+    {
+        std::vector<Texture> textures;
+        for (const TextureRef &ref : view.textures)
+            textures.push_back(loadMaterialTexture(ref));
+
+        bufferPool = &BufferPool::shared(view.vertexFormat);
+        Mesh meshObj(*bufferPool, view.vertices, view.vertexCount, view.indices, view.indexCount, view.indexType, textures);
+        meshObj.setMaterial(view.material);
+        meshObj.setPositionTransform(view.positionScale, view.positionOffset);
+        meshes.push_back(meshObj);
+    }
 
-            Texture texture;
-            std::string filename = str.C_Str();
-            filename = filename.substr(filename.find_last_of('\\') + 1, filename.length());
-            std::cout << "Loading texture at path " << filename << "...\n";
-            texture.id = loadTexture(filename.c_str(), dir);
-            texture.type = typeName;
-            texture.path = filename;
-            textures.push_back(texture);
-            // Memorize texture for other potential loadings
-            loadedTextures.push_back(texture);
-        }
-        return textures;
+    Texture loadMaterialTexture(const TextureRef &ref)
+    {
+        // All textures are loaded before the meshes (see upload())
+        Texture texture = loadedTextures[ref.path];
+        texture.type = ref.type;
+        return texture;
+    }
+
+    static std::string textureFilename(const std::string &path)
+    {
+        return path.substr(path.find_last_of('\\') + 1, path.length());
     }
 
     void updateModelMat()
@@ -188,44 +494,73 @@ public:
     }
 };
 
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int loadTexture(const char *path, const std::string &dir)
+// utility functions for loading a 2D texture from file
+// ----------------------------------------------------
+// Decoding only touches CPU memory, so it may run on any thread. With acquireShared, an image
+// already in the registry is not decoded: a reference is taken instead (see sharedId), so that
+// the texture cannot be released before the caller uses it.
+TextureImage decodeTexture(const std::string &path, const bool &acquireShared)
+{
+    CPU_PROFILE_SCOPE("Decode texture");
+    auto start = std::chrono::steady_clock::now();
+    TextureImage image;
+    image.path = path;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    image.contentHash = Hash::fnv1a(bytes.data(), bytes.size());
+    // No need to decode an image that is already on the GPU under another name
+    if (acquireShared && !bytes.empty())
+        image.sharedId = TextureRegistry::instance().acquireByContent(TextureRegistry::canonicalPath(path),
+                                                                      image.contentHash);
+    if (!bytes.empty() && image.sharedId == 0)
+        image.data = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(bytes.data()), bytes.size(),
+                                           &image.width, &image.height, &image.nrComponents, 0);
+    image.decodeMs = MeshCache::elapsedMs(start);
+    return image;
+}
+
+// Must be called from the thread owning the GL context. Frees the decoded pixels.
+unsigned int uploadTexture(TextureImage &image)
 {
-    std::string filename(path);
-    filename = dir + '/' + filename;
-
     unsigned int textureID;
     glGenTextures(1, &textureID);
     
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    if (image.data)
     {
         GLenum format;
-        if (nrComponents == 1)
+        if (image.nrComponents == 1)
             format = GL_RED;
-        else if (nrComponents == 3)
+        else if (image.nrComponents == 3)
             format = GL_RGB;
-        else if (nrComponents == 4)
+        else if (image.nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        GLState::bindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
     }
     else
     {
-        std::cout << "Texture failed to load at path: " << filename << std::endl;
-        stbi_image_free(data);
+        std::cout << "Texture failed to load at path: " << image.path << std::endl;
     }
+    stbi_image_free(image.data);
+    image.data = nullptr;
 
     return textureID;
+}
+
+unsigned int loadTexture(const char *path, const std::string &dir)
+{
+    std::string filename(path);
+    filename = dir + '/' + filename;
+
+    // The caller owns the texture, outside of the registry
+    TextureImage image = decodeTexture(filename, false);
+    return uploadTexture(image);
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Model.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Loads models without blocking the render loop: files are read and textures decoded on a
+// background thread, then GL uploads are spread over several frames by update().
+class ModelLoader
+{
+public:
+    class Handle
+    {
+    public:
+        enum class Stage { Queued, Reading, Decoding, Uploading, Ready, Failed };
+
+        // Wall-clock time of each loading phase; uploads are spread over several frames
+        struct Timings {
+            double readMs {0.0}, decodeMs {0.0}, uploadMs {0.0};
+        };
+
+        Stage getStage() { return stage; }
+        bool isReady() { return stage == Stage::Ready; }
+        bool hasFailed() { return stage == Stage::Failed; }
+        const std::string &getPath() { return path; }
+
+        float getProgress()
+        {
+            if (stage == Stage::Ready) return 1.0f;
+            return model->getProgress();
+        }
+
+        // Valid as soon as the files have been read, e.g. to draw a proxy
+        bool getBounds(glm::vec3 &min, glm::vec3 &max) { return model->getBounds(min, max); }
+
+        // Only usable once isReady() returns true
+        Model &getModel() { return *model; }
+        const Timings &getTimings() { return timings; }
+
+    private:
+        friend class ModelLoader;
+
+        Handle(const std::string &path) : path(path), model(std::make_unique<Model>()) {}
+
+        std::string path;
+        std::unique_ptr<Model> model;
+        std::atomic<Stage> stage {Stage::Queued};
+        Timings timings;
+        std::chrono::steady_clock::time_point uploadStart;
+    };
+
+    std::shared_ptr<Handle> load(const std::string &path, const Model::ImportOptions &options = Model::ImportOptions())
+    {
+        std::shared_ptr<Handle> handle(new Handle(path));
+        // A single reader thread: texture decoding is already spread over the shared pool
+        reader.submit([this, handle, options] {
+            handle->stage = Handle::Stage::Reading;
+            auto start = std::chrono::steady_clock::now();
+            if (!handle->model->read(handle->path, options)) {
+                handle->stage = Handle::Stage::Failed;
+                return;
+            }
+            handle->timings.readMs = MeshCache::elapsedMs(start);
+            handle->stage = Handle::Stage::Decoding;
+            start = std::chrono::steady_clock::now();
+            handle->model->decodeTextures();
+            handle->timings.decodeMs = MeshCache::elapsedMs(start);
+            handle->stage = Handle::Stage::Uploading;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_back(handle);
+        });
+        return handle;
+    }
+
+    // Call once per frame on the GL thread. Uploads at most budgetMs worth of data.
+    void update(const double &budgetMs)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const std::shared_ptr<Handle> &handle : decoded)
+                handle->uploadStart = std::chrono::steady_clock::now();
+            uploading.insert(uploading.end(), decoded.begin(), decoded.end());
+            decoded.clear();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        while (!uploading.empty()) {
+            double remainingMs = budgetMs - MeshCache::elapsedMs(start);
+            if (remainingMs <= 0.0) return;
+
+            std::shared_ptr<Handle> handle = uploading.front();
+            if (!handle->model->upload(remainingMs)) return;
+            handle->timings.uploadMs = MeshCache::elapsedMs(handle->uploadStart);
+            handle->stage = Handle::Stage::Ready;
+            uploading.erase(uploading.begin());
+        }
+    }
+
+private:
+    // Handles whose CPU work is done, waiting for the GL thread
+    std::vector<std::shared_ptr<Handle>> decoded;
+    std::mutex mutex;
+    // GL thread only
+    std::vector<std::shared_ptr<Handle>> uploading;
+
+    // Declared last so that it is joined before the members above are destroyed
+    ThreadPool reader {1, "Model reader"};
+};
@@ -68,7 +68,7 @@ public:
     {
         // initialize vertex attributs layout
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         // Prepare GPU buffer for receiving 3D positions
         glGenBuffers(1, &VBO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -84,7 +84,7 @@ public:
 
     ~Object()
     {
-        glDeleteVertexArrays(1, &VAO);
+        GLState::deleteVertexArrays(1, &VAO);
         glDeleteBuffers(1, &VBO);
     }
 
@@ -109,8 +109,7 @@ public:
 
     void draw()
     {
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
     }
 };
\ No newline at end of file
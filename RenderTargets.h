@@ -0,0 +1,277 @@
+#pragma once
+
+#include "GLState.h"
+#include "Shader.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Offscreen targets of the deferred pipeline: the G-buffer (see Layout), the SSAO and SSAO blur outputs and, below full resolution, the
+// lit scene to be upscaled to the window, plus a window-sized intermediate of the upscaling
+// passes. They are rendered at the window size times a render scale (fixed, or picked by
+// DynamicResolution). Each size gets its own set of targets, kept in a small pool so that
+// going back and forth between scales does not reallocate; the least recently used set is
+// released when the pool is full.
+// A new window size only takes effect once it has not changed for debounceSeconds, so that
+// dragging a window edge does not reallocate every frame. It empties the pool.
+// GL objects live as long as the context: nothing is released on destruction.
+class RenderTargets
+{
+public:
+    static constexpr double debounceSeconds {0.25};
+    // Sets of targets kept at once
+    static constexpr size_t poolSize {4};
+
+    // Classic: RGB16F view space position, RGB16F normal, RGB8 color and a depth renderbuffer.
+    // Compact: octahedral RG16 normal, RGBA8 color + specular and a depth texture from which
+    // view space positions are rebuilt with the inverse projection, about half the bandwidth.
+    enum class Layout { Classic, Compact };
+
+    RenderTargets(const unsigned int &width, const unsigned int &height, const Layout &layout = Layout::Compact) :
+        layout(layout), requestedWidth(width), requestedHeight(height) {}
+
+    RenderTargets(const RenderTargets &) = delete;
+    RenderTargets &operator=(const RenderTargets &) = delete;
+
+    // From the framebuffer resize callback. Empty sizes (minimized window) are ignored.
+    void requestResize(const unsigned int &newWidth, const unsigned int &newHeight)
+    {
+        if (newWidth == 0 || newHeight == 0) return;
+        requestedWidth = newWidth;
+        requestedHeight = newHeight;
+        requestTime = std::chrono::steady_clock::now();
+    }
+
+    // Fraction of the window size rendered, applied on the next update()
+    void setScale(const float &newScale) { scale = std::min(std::max(newScale, 0.1f), 1.0f); }
+    float getScale() { return scale; }
+
+    Layout getLayout() { return layout; }
+    // Defines selecting the layout in the geometry, SSAO and illumination shaders
+    Shader::Defines getDefines()
+    {
+        if (layout == Layout::Compact) return {{"COMPACT_GBUFFER", "1"}};
+        return {};
+    }
+    // Bytes written per pixel by the geometry pass, depth included
+    unsigned int getBytesPerPixel() { return layout == Layout::Compact ? 12 : 19; }
+
+    // Call once per frame before the first pass. Returns true when targets were allocated.
+    bool update()
+    {
+        frameIndex++;
+        bool resized = requestedWidth != windowWidth || requestedHeight != windowHeight;
+        if (resized && (windowWidth == 0 || std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - requestTime).count() >= debounceSeconds)) {
+            windowWidth = requestedWidth;
+            windowHeight = requestedHeight;
+            for (const std::unique_ptr<Set> &set : pool) release(*set);
+            pool.clear();
+            current = nullptr;
+            GLState::deleteFramebuffers(1, &upscaleFbo);
+            GLState::deleteTextures(1, &upscaleTex);
+            upscaleFbo = upscaleTex = 0;
+        }
+
+        unsigned int width = std::max(1u, (unsigned int)std::lround(windowWidth * scale));
+        unsigned int height = std::max(1u, (unsigned int)std::lround(windowHeight * scale));
+        if (current && current->width == width && current->height == height) {
+            current->lastUse = frameIndex;
+            return false;
+        }
+        for (const std::unique_ptr<Set> &set : pool)
+            if (set->width == width && set->height == height) {
+                current = set.get();
+                current->lastUse = frameIndex;
+                return false;
+            }
+
+        if (pool.size() == poolSize) {
+            auto oldest = std::min_element(pool.begin(), pool.end(), [](const std::unique_ptr<Set> &a, const std::unique_ptr<Set> &b) {
+                return a->lastUse < b->lastUse;
+            });
+            release(**oldest);
+            pool.erase(oldest);
+        }
+        pool.push_back(std::make_unique<Set>());
+        current = pool.back().get();
+        current->width = width;
+        current->height = height;
+        current->lastUse = frameIndex;
+        bool scaled = width != windowWidth || height != windowHeight;
+        allocate(*current, layout, scaled);
+        if (scaled && upscaleFbo == 0) allocateUpscale();
+        allocations++;
+        return true;
+    }
+
+    // Render size of the offscreen passes
+    unsigned int getWidth() { return current->width; }
+    unsigned int getHeight() { return current->height; }
+    unsigned int getWindowWidth() { return windowWidth; }
+    unsigned int getWindowHeight() { return windowHeight; }
+    // False at full resolution: the scene is then lit straight into the window
+    bool isScaled() { return current->sceneFbo != 0; }
+    // Sets allocated so far, including the first one
+    unsigned int getAllocations() { return allocations; }
+
+    unsigned int getGBuffer() { return current->gBuffer; }
+    // View space positions with the classic layout, depth with the compact one: shaders read
+    // it as positionTex or depthTex respectively
+    unsigned int getPositionSourceTex() { return layout == Layout::Compact ? current->depthTex : current->positionTex; }
+    unsigned int getNormalTex() { return current->normalTex; }
+    unsigned int getColorSpecTex() { return current->colorSpecTex; }
+    unsigned int getSsaoFbo() { return current->ssaoFbo; }
+    unsigned int getSsaoTex() { return current->ssaoTex; }
+    unsigned int getBlurFbo() { return current->blurFbo; }
+    unsigned int getBlurTex() { return current->blurTex; }
+    // Only when isScaled()
+    unsigned int getSceneFbo() { return current->sceneFbo; }
+    unsigned int getSceneTex() { return current->sceneTex; }
+    // Upscaled scene before sharpening, at the window size. Only when isScaled().
+    unsigned int getUpscaleFbo() { return upscaleFbo; }
+    unsigned int getUpscaleTex() { return upscaleTex; }
+
+private:
+    struct Set {
+        unsigned int width {0}, height {0};
+        uint64_t lastUse {0};
+        unsigned int gBuffer {0}, depthBuffer {0};
+        unsigned int positionTex {0}, normalTex {0}, colorSpecTex {0}, depthTex {0};
+        unsigned int ssaoFbo {0}, ssaoTex {0};
+        unsigned int blurFbo {0}, blurTex {0};
+        unsigned int sceneFbo {0}, sceneTex {0}, sceneDepthBuffer {0};
+    };
+
+    Layout layout;
+    unsigned int windowWidth {0}, windowHeight {0};
+    unsigned int requestedWidth, requestedHeight;
+    std::chrono::steady_clock::time_point requestTime;
+    float scale {1.0f};
+    std::vector<std::unique_ptr<Set>> pool;
+    Set *current {nullptr};
+    unsigned int upscaleFbo {0}, upscaleTex {0};
+    uint64_t frameIndex {0};
+    unsigned int allocations {0};
+
+    static void allocate(Set &set, const Layout &layout, const bool &withScene)
+    {
+        // Deferred shading geometry pass
+        glGenFramebuffers(1, &set.gBuffer);
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, set.gBuffer);
+        if (layout == Layout::Compact) {
+            set.normalTex = createTexture(set, GL_RG16, GL_RG, GL_UNSIGNED_SHORT, GL_NEAREST);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, set.normalTex, 0);
+            set.colorSpecTex = createTexture(set, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_NEAREST);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, set.colorSpecTex, 0);
+            GLenum frameBufferTextures[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+            glDrawBuffers(2, frameBufferTextures);
+            // Sampled by the lighting passes, so a texture rather than a renderbuffer
+            set.depthTex = createTexture(set, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, set.depthTex, 0);
+        }
+        else {
+            set.positionTex = createTexture(set, GL_RGB16F, GL_RGB, GL_FLOAT, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, set.positionTex, 0);
+            set.normalTex = createTexture(set, GL_RGB16F, GL_RGB, GL_FLOAT, GL_NEAREST);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, set.normalTex, 0);
+            set.colorSpecTex = createTexture(set, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE, GL_NEAREST);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, set.colorSpecTex, 0);
+            GLenum frameBufferTextures[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+            glDrawBuffers(3, frameBufferTextures);
+            set.depthBuffer = createRenderbuffer(set, GL_DEPTH_COMPONENT);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, set.depthBuffer);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Framebuffer not complete ! " << std::endl;
+
+        glGenFramebuffers(1, &set.ssaoFbo);
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, set.ssaoFbo);
+        set.ssaoTex = createTexture(set, GL_RED, GL_RGB, GL_FLOAT, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, set.ssaoTex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SSAO framebuffer not complete !" << std::endl;
+
+        // SAAO blur (smooth AO result)
+        glGenFramebuffers(1, &set.blurFbo);
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, set.blurFbo);
+        set.blurTex = createTexture(set, GL_RED, GL_RGB, GL_FLOAT, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, set.blurTex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SSAO blur buffer not complete !" << std::endl;
+
+        // Lit scene and skybox, filtered when upscaled
+        if (withScene) {
+            glGenFramebuffers(1, &set.sceneFbo);
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, set.sceneFbo);
+            set.sceneTex = createTexture(set, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, set.sceneTex, 0);
+            set.sceneDepthBuffer = createRenderbuffer(set, GL_DEPTH_COMPONENT);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, set.sceneDepthBuffer);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "Scene framebuffer not complete !" << std::endl;
+        }
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void allocateUpscale()
+    {
+        glGenFramebuffers(1, &upscaleFbo);
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, upscaleFbo);
+        glGenTextures(1, &upscaleTex);
+        GLState::bindTexture(GL_TEXTURE_2D, upscaleTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, windowWidth, windowHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, upscaleTex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Upscale framebuffer not complete !" << std::endl;
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Leaves the texture bound, for extra parameters
+    static unsigned int createTexture(const Set &set, const GLint &internalFormat, const GLenum &format,
+                                      const GLenum &type, const GLint &filter)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        GLState::bindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, set.width, set.height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        return texture;
+    }
+
+    static unsigned int createRenderbuffer(const Set &set, const GLenum &internalFormat)
+    {
+        unsigned int renderbuffer;
+        glGenRenderbuffers(1, &renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, set.width, set.height);
+        return renderbuffer;
+    }
+
+    static void release(const Set &set)
+    {
+        const unsigned int framebuffers[] {set.gBuffer, set.ssaoFbo, set.blurFbo, set.sceneFbo};
+        GLState::deleteFramebuffers(4, framebuffers);
+        const unsigned int textures[] {set.positionTex, set.normalTex, set.colorSpecTex, set.depthTex, set.ssaoTex,
+                                       set.blurTex, set.sceneTex};
+        GLState::deleteTextures(7, textures);
+        const unsigned int renderbuffers[] {set.depthBuffer, set.sceneDepthBuffer};
+        glDeleteRenderbuffers(2, renderbuffers);
+    }
+};
@@ -6,42 +6,31 @@
 class ScreenSpaceAO
 {
 public:
-	ScreenSpaceAO(unsigned int screenWidth, unsigned int screenHeight)
-		: SCREEN_WIDTH(screenWidth), SCREEN_HEIGHT(screenHeight)
-	{
-		glGenFramebuffers(1, &ssaoFBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-		glGenTextures(1, &ssaoOutputTex);
-		glBindTexture(GL_TEXTURE_2D, ssaoOutputTex);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, screenWidth, screenHeight, 0, GL_RGB, GL_FLOAT, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoOutputTex, 0);
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "SSAO framebuffer not complete !" << std::endl;
+	enum class Quality { Low, Medium, High };
 
-		// SAAO blur (smooth AO result)
-		glGenFramebuffers(1, &blurFBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, blurFBO);
-		glGenTextures(1, &ssaoBlurOutputTex);
-		glBindTexture(GL_TEXTURE_2D, ssaoBlurOutputTex);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, screenWidth, screenHeight, 0, GL_RGB, GL_FLOAT, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoBlurOutputTex, 0);
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "SSAO blur buffer not complete !" << std::endl;
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// Number of samples of the SSAO kernel, the KERNEL_SIZE define of ssaoFS.frag
+	static unsigned int kernelSizeFor(const Quality &quality)
+	{
+		switch (quality) {
+			case Quality::Low: return 16;
+			case Quality::Medium: return 32;
+			default: return 64;
+		}
+	}
 
-		// Generate 64 random samples for ambient occlusion calculations
-		for (unsigned int i = 0; i < 64; i++) {
+	// Kernel and noise only: the SSAO and blur targets are sized with the window, see RenderTargets
+	ScreenSpaceAO(const Quality &quality = Quality::High) : kernelSize(kernelSizeFor(quality))
+	{
+		// Generate random samples for ambient occlusion calculations
+		ssaoKernel.resize(kernelSize);
+		for (unsigned int i = 0; i < kernelSize; i++) {
 			float x = ((rand() % 100) / 100.0) * 2.0 - 1.0;
 			float y = ((rand() % 100) / 100.0) * 2.0 - 1.0;
 			float z = ((rand() % 100) / 100.0);
 			glm::vec3 sample {x, y, z};
 			sample = glm::normalize(sample);
 			// Distribute samples in bigger number on small lengths (close to 0.1)
-			float t = i / (float)64;
+			float t = i / (float)kernelSize;
 			float scale = 0.1f + (t * t) * 0.9f;
 			ssaoKernel[i] = sample * scale;
 		}
@@ -53,7 +42,7 @@ public:
 		}
 
 		glGenTextures(1, &noiseTex);
-		glBindTexture(GL_TEXTURE_2D, noiseTex);
+		GLState::bindTexture(GL_TEXTURE_2D, noiseTex);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 4, 4, 0, GL_RGBA, GL_FLOAT, &ssaoNoise[0]);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -61,40 +50,32 @@ public:
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	}
 
-	unsigned int getFbo() { return ssaoFBO; }
-	unsigned int getBlurFbo() { return blurFBO; }
-	unsigned int getOutputTexId() { return ssaoOutputTex; }
-	unsigned int getBlurOutputTexId() { return ssaoBlurOutputTex; }
+	// Defines specializing ssaoFS.frag for this kernel
+	Shader::Defines getDefines() { return {{"KERNEL_SIZE", std::to_string(kernelSize)}}; }
 
+	// gPositionTex holds view space positions or depth, depending on the G-buffer layout
 	void setUniforms(Shader &shader, unsigned int gPositionTex, unsigned int gNormalTex)
 	{
-		glActiveTexture(GL_TEXTURE10);
-		glBindTexture(GL_TEXTURE_2D, noiseTex);
-		glActiveTexture(GL_TEXTURE29);
-		glBindTexture(GL_TEXTURE_2D, gPositionTex);
-		glActiveTexture(GL_TEXTURE30);
-		glBindTexture(GL_TEXTURE_2D, gNormalTex);
+		GLState::bindTexture(10, GL_TEXTURE_2D, noiseTex);
+		GLState::bindTexture(29, GL_TEXTURE_2D, gPositionTex);
+		GLState::bindTexture(30, GL_TEXTURE_2D, gNormalTex);
 		shader.use();
-		for (unsigned int i = 0; i < 64; i++) {
-			shader.setVec3("kernelSamples[" + std::to_string(i) + "]", ssaoKernel[i]);
+		// The kernel never changes: upload it once per program
+		if (kernelProgram != shader.ID) {
+			shader.uniform<glm::vec3>("kernelSamples").set(ssaoKernel.data(), kernelSize);
+			kernelProgram = shader.ID;
 		}
 	}
 
-	void setBlurUniforms(Shader &shader)
+	void setBlurUniforms(Shader &shader, unsigned int ssaoTex)
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, ssaoOutputTex);
+		GLState::bindTexture(0, GL_TEXTURE_2D, ssaoTex);
 	}
 
 private:
-	unsigned int ssaoFBO;
-	unsigned int ssaoOutputTex;
-	unsigned int blurFBO;
-	unsigned int ssaoBlurOutputTex;
-
-	glm::vec3 ssaoKernel[64];
+	unsigned int kernelSize;
+	std::vector<glm::vec3> ssaoKernel;
 	glm::vec3 ssaoNoise[16];
 	unsigned int noiseTex;
-
-	const float SCREEN_WIDTH, SCREEN_HEIGHT;
+	unsigned int kernelProgram {0};
 };
\ No newline at end of file
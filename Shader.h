@@ -1,11 +1,28 @@
 #pragma once
 
+#include "CpuProfiler.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Hash.h"
+#include "ThreadPool.h"
+
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iomanip>
+#include <optional>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -14,126 +31,527 @@ class Shader
 {
 private:
     static const std::string baseDir;
+    // Linked program binaries, next to the mesh cache
+    static const std::string binaryDir;
+
+    struct UniformInfo {
+        int location {-1};
+        GLenum type {GL_NONE};
+        // Number of elements for arrays, 1 otherwise
+        int size {1};
+    };
+    // Active uniforms by name, filled after linking. Array uniforms appear both as "name"
+    // and "name[0]"; other elements are added on first use.
+    mutable std::unordered_map<std::string, UniformInfo> uniforms;
 
 public:
     // Program ID
     unsigned int ID;
 
-    Shader(const GLchar *vertexPath, const GLchar *geometryPath, const GLchar *fragmentPath) {
+    // #define name and value pairs, inserted after the #version line of every stage
+    using Defines = std::vector<std::pair<std::string, std::string>>;
+
+    // Uniform block shared by all programs (see FrameData.h), bound to a fixed binding point
+    static const std::string frameDataBlockName;
+    static constexpr unsigned int frameDataBinding {0};
+
+    // Location resolved once, set with no string work nor driver lookup. The program must
+    // be in use when calling set(). Handles of inactive uniforms do nothing.
+    template <typename T>
+    class Uniform
+    {
+    public:
+        Uniform() {}
+        Uniform(const int &location, const int &size) : location(location), size(size) {}
+
+        void set(const T &value) const { upload(location, 1, &value); }
+        // First count elements of an array uniform
+        void set(const T *values, const int &count) const { upload(location, std::min(count, size), values); }
+
+        bool isActive() const { return location >= 0; }
+
+    private:
+        int location {-1}, size {0};
+    };
+
+    // With parallelCompile, programs are only submitted to the driver here and their status is
+    // queried on first use, so that constructing several shaders in a row keeps the driver busy
+    // on all of them. Without it, every program is ready when the constructor returns.
+    Shader(const GLchar *vertexPath, const GLchar *geometryPath, const GLchar *fragmentPath, const Defines &defines = Defines()) {
+        CPU_PROFILE_SCOPE("Shader");
 
         // Read shader source files and convert them into strings
-        std::string vertexCode;
+        std::string vertexCode = readSource(vertexPath);
         std::string geometryCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream gShaderFile;
-        std::ifstream fShaderFile;
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try {
-            vShaderFile.open(baseDir + vertexPath);
-            fShaderFile.open(baseDir + fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            vShaderFile.close();
-            fShaderFile.close();
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-            if (geometryPath != "") {
-                gShaderFile.open(baseDir + geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+        std::string fragmentCode = readSource(fragmentPath);
+        if (geometryPath && geometryPath[0] != '\0')
+            geometryCode = readSource(geometryPath);
+        vertexCode = withDefines(vertexCode, defines);
+        geometryCode = withDefines(geometryCode, defines);
+        fragmentCode = withDefines(fragmentCode, defines);
+        // Reuse the program linked by a previous run when the driver accepts it
+        auto start = std::chrono::steady_clock::now();
+        pending.key = programKey(vertexCode, geometryCode, fragmentCode);
+        double savedCompileMs {0.0};
+        if (loadBinary(pending.key, savedCompileMs)) {
+            cacheStats.hits++;
+            cacheStats.savedMs += savedCompileMs - elapsedMs(start);
+            setup();
+            return;
         }
-        catch(std::ifstream::failure e) {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+        submit(vertexCode, geometryCode, fragmentCode);
+        pending.submitMs = elapsedMs(start);
+        pending.active = true;
+        if (!parallelCompile) finish();
+    }
+
+    // Shader objects of a program never waited for, finish() deletes them otherwise
+    ~Shader()
+    {
+        if (!pending.active) return;
+        glDeleteShader(pending.vertex);
+        if (pending.geometry) glDeleteShader(pending.geometry);
+        glDeleteShader(pending.fragment);
+    }
+
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+
+    void use() const {
+        finish();
+        GLState::useProgram(ID);
+    }
+
+    // Off to compile, link and query every program one after the other, e.g. to measure the
+    // time to first frame without parallel compilation. Set before creating any shader.
+    static bool parallelCompile;
+
+    // Read every file of the shader directory on the worker pool, so that the constructors
+    // do not wait on the disk one file at a time
+    static void preloadSources()
+    {
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::directory_iterator(baseDir, ec)) {
+            if (!entry.is_regular_file()) continue;
+            std::string path = entry.path().string();
+            preloaded.emplace(entry.path().filename().string(), ThreadPool::shared().submit([path] {
+                std::string code;
+                return readFile(path, code) ? std::optional<std::string>(code) : std::nullopt;
+            }).share());
         }
-        const char *vShaderCode = vertexCode.c_str();
-        const char *gShaderCode = geometryCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
+    }
 
-        // Create and compile shaders
-        unsigned int vertex, geometry, fragment;
-        int success;
-        char infoLog[512];
+    // Drop the preloaded sources once the startup programs are submitted. Later shaders read
+    // their files from the disk.
+    static void releaseSources() { preloaded.clear(); }
 
-        // Vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    struct CacheStats {
+        unsigned int hits {0}, misses {0};
+        // Time spent compiling on misses, and compile time avoided on hits (minus loading time)
+        double compileMs {0.0}, savedMs {0.0};
+    };
+
+    static void printCacheStats()
+    {
+        std::cout << "Program binary cache: " << cacheStats.hits << " hit(s), " << cacheStats.misses << " miss(es), "
+                  << cacheStats.compileMs << " ms compiling, " << cacheStats.savedMs << " ms saved" << std::endl;
+    }
+
+    // Typed handle on a uniform, to be resolved once (e.g. at initialization)
+    template <typename T>
+    Uniform<T> uniform(const std::string &name) const
+    {
+        const UniformInfo *info = find(name);
+        if (!info) return Uniform<T>();
+        if (!acceptsType<T>(info->type)) {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH " << name << std::endl;
+            return Uniform<T>();
         }
-        // Geometry shader
-        bool hasGeometryShader = geometryCode.size() > 0;
-        if (hasGeometryShader) {
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            glGetShaderiv(geometry, GL_COMPILE_STATUS, &success);
-            if (!success) {
-                glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-                std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        return Uniform<T>(info->location, info->size);
+    }
+
+    // Convenience setters for one-off updates: a hashed lookup in the uniform table, no driver query
+    void setBool(const std::string &name, const bool &value) {         
+        glUniform1i(location(name), (int)value); 
+    }
+    void setInt(const std::string &name, const int &value) { 
+        glUniform1i(location(name), value); 
+    }
+    void setFloat(const std::string &name, float value) { 
+        glUniform1f(location(name), value); 
+    } 
+
+    void setVec3(const std::string &name, const glm::vec3 &value) {
+        glUniform3f(location(name), value[0], value[1], value[2]);
+    }
+
+    void setVec4(const std::string &name, const glm::vec4 &value) {
+        glUniform4f(location(name), value[0], value[1], value[2], value[3]);
+    }
+
+    void setMatrix4f(const std::string &name, const glm::mat4 &value) {
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, glm::value_ptr(value));
+    }
+
+private:
+    static CacheStats cacheStats;
+
+    struct BinaryHeader {
+        char magic[8];
+        uint64_t key;
+        uint32_t binaryFormat;
+        uint32_t length;
+        // Compile time of the program when it was stored
+        double compileMs;
+    };
+    static constexpr char binaryMagic[8] {'G', 'L', 'P', 'R', 'O', 'G', '1', '\0'};
+
+    // Program submitted to the driver whose status has not been checked yet
+    struct PendingProgram {
+        bool active {false};
+        unsigned int vertex {0}, geometry {0}, fragment {0};
+        uint64_t key {0};
+        // Time spent submitting the program, the rest is counted when waiting for it
+        double submitMs {0.0};
+    };
+    mutable PendingProgram pending;
+
+    static std::unordered_map<std::string, std::shared_future<std::optional<std::string>>> preloaded;
+
+    static bool readFile(const std::string &path, std::string &code)
+    {
+        std::ifstream file(path);
+        if (!file) return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        code = stream.str();
+        return true;
+    }
+
+    // Source of a shader file, with every line #include "<file>" replaced by that file of the
+    // shader directory (e.g. the FrameData block of FrameData.glsl). Each file is included at
+    // most once per stage.
+    static std::string readSource(const std::string &name)
+    {
+        std::unordered_set<std::string> included {name};
+        return expandIncludes(readShaderFile(name), included);
+    }
+
+    static std::string expandIncludes(const std::string &code, std::unordered_set<std::string> &included)
+    {
+        std::string expanded;
+        std::istringstream lines(code);
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+                expanded += line + '\n';
+                continue;
             }
+            size_t open = line.find('"', start), close = line.find('"', open + 1);
+            if (open == std::string::npos || close == std::string::npos) {
+                std::cout << "ERROR::SHADER::INVALID_INCLUDE " << line << std::endl;
+                continue;
+            }
+            std::string name = line.substr(open + 1, close - open - 1);
+            if (included.insert(name).second)
+                expanded += expandIncludes(readShaderFile(name), included);
         }
-        // Fragment shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
+        return expanded;
+    }
+
+    static std::string readShaderFile(const std::string &name)
+    {
+        auto it = preloaded.find(name);
+        if (it != preloaded.end() && it->second.get()) return *it->second.get();
+        std::string code;
+        if (!readFile(baseDir + name, code))
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ " << name << std::endl;
+        return code;
+    }
+
+    static unsigned int submitStage(const GLenum &type, const std::string &code)
+    {
+        const char *source = code.c_str();
+        unsigned int stage = glCreateShader(type);
+        glShaderSource(stage, 1, &source, NULL);
+        glCompileShader(stage);
+        return stage;
+    }
+
+    // Compile the stages and link them into ID, without querying anything: drivers compiling
+    // on their own threads (KHR_parallel_shader_compile) only block on the first status query
+    void submit(const std::string &vertexCode, const std::string &geometryCode, const std::string &fragmentCode)
+    {
+        pending.vertex = submitStage(GL_VERTEX_SHADER, vertexCode);
+        if (geometryCode.size() > 0) pending.geometry = submitStage(GL_GEOMETRY_SHADER, geometryCode);
+        pending.fragment = submitStage(GL_FRAGMENT_SHADER, fragmentCode);
 
         // Create shader program
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        if (hasGeometryShader) glAttachShader(ID, geometry);
-        glAttachShader(ID, fragment);
+        if (GLExtensions::hasProgramBinary())
+            GLExtensions::programParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(ID, pending.vertex);
+        if (pending.geometry) glAttachShader(ID, pending.geometry);
+        glAttachShader(ID, pending.fragment);
         glLinkProgram(ID);
+    }
+
+    static bool checkStage(const unsigned int &stage, const char *name)
+    {
+        int success;
+        glGetShaderiv(stage, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            char infoLog[512];
+            glGetShaderInfoLog(stage, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::" << name << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+        return success;
+    }
+
+    // Wait for a submitted program, report errors and finish its setup. Does nothing once done.
+    void finish() const
+    {
+        if (!pending.active) return;
+        pending.active = false;
+        CPU_PROFILE_SCOPE("Shader::finish");
+
+        auto start = std::chrono::steady_clock::now();
+        bool compiled = checkStage(pending.vertex, "VERTEX");
+        if (pending.geometry) compiled = checkStage(pending.geometry, "GEOMETRY") && compiled;
+        compiled = checkStage(pending.fragment, "FRAGMENT") && compiled;
+        int success;
         glGetProgramiv(ID, GL_LINK_STATUS, &success);
         if (!success) {
+            char infoLog[512];
             glGetProgramInfoLog(ID, 512, NULL, infoLog);
             std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
         }
         // Shader objects are useless once linked to the program
-        glDeleteShader(vertex);
-        if (hasGeometryShader) glDeleteShader(geometry);
-        glDeleteShader(fragment);
+        glDeleteShader(pending.vertex);
+        if (pending.geometry) glDeleteShader(pending.geometry);
+        glDeleteShader(pending.fragment);
+
+        double compileMs = pending.submitMs + elapsedMs(start);
+        cacheStats.misses++;
+        cacheStats.compileMs += compileMs;
+        if (compiled && success) {
+            saveBinary(pending.key, compileMs);
+            setup();
+        }
     }
 
-    void use() {
-        glUseProgram(ID);
+    void setup() const
+    {
+        introspectUniforms();
+        // GLSL 3.30 has no layout(binding) qualifier for blocks
+        unsigned int frameDataIndex = glGetUniformBlockIndex(ID, frameDataBlockName.c_str());
+        if (frameDataIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, frameDataIndex, frameDataBinding);
     }
 
-    void setBool(const std::string &name, const bool &value) {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    static std::string withDefines(const std::string &code, const Defines &defines)
+    {
+        if (code.empty() || defines.empty()) return code;
+        std::string lines;
+        for (const auto &define : defines)
+            lines += "#define " + define.first + " " + define.second + "\n";
+        // #version must stay the first statement
+        size_t versionLine = code.find("#version");
+        size_t insertAt = versionLine == std::string::npos ? 0 : code.find('\n', versionLine);
+        if (insertAt == std::string::npos) return code + "\n" + lines;
+        if (versionLine != std::string::npos) insertAt++;
+        return code.substr(0, insertAt) + lines + code.substr(insertAt);
     }
-    void setInt(const std::string &name, const int &value) { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+
+    // Binaries are only valid for the exact same sources and driver
+    static uint64_t programKey(const std::string &vertexCode, const std::string &geometryCode, const std::string &fragmentCode)
+    {
+        uint64_t key = Hash::fnvOffsetBasis;
+        for (const std::string *code : {&vertexCode, &geometryCode, &fragmentCode}) {
+            uint64_t size = code->size();
+            key = Hash::fnv1a(&size, sizeof(size), key);
+            key = Hash::fnv1a(code->data(), code->size(), key);
+        }
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const char *value = (const char *)glGetString(name);
+            if (value) key = Hash::fnv1a(value, std::strlen(value), key);
+        }
+        return key;
     }
-    void setFloat(const std::string &name, float value) { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
-    } 
 
-    void setVec3(const std::string &name, const glm::vec3 &value) {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), value[0], value[1], value[2]);
+    static std::string binaryPath(const uint64_t &key)
+    {
+        std::ostringstream path;
+        path << binaryDir << std::hex << std::setw(16) << std::setfill('0') << key << ".program";
+        return path.str();
     }
 
-    void setVec4(const std::string &name, const glm::vec4 &value) {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), value[0], value[1], value[2], value[3]);
+    // Create ID from a stored binary. Leaves ID at 0 when there is no usable binary.
+    bool loadBinary(const uint64_t &key, double &compileMs)
+    {
+        ID = 0;
+        if (!GLExtensions::hasProgramBinary()) return false;
+
+        std::ifstream file(binaryPath(key), std::ios::binary | std::ios::ate);
+        if (!file) return false;
+        std::streamoff fileSize = file.tellg();
+        file.seekg(0);
+        BinaryHeader header;
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+        if (std::memcmp(header.magic, binaryMagic, sizeof(binaryMagic)) != 0 || header.key != key) return false;
+        // Entries are written whole: any other length means a truncated or corrupt file
+        if ((std::streamoff)header.length != fileSize - (std::streamoff)sizeof(header)
+            || !GLExtensions::isProgramBinaryFormat(header.binaryFormat))
+            return false;
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size())) return false;
+
+        ID = glCreateProgram();
+        GLExtensions::programBinary(ID, header.binaryFormat, binary.data(), binary.size());
+        int success;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success) {
+            // Typically after a driver update: compile again and overwrite the entry
+            GLState::deleteProgram(ID);
+            ID = 0;
+            return false;
+        }
+        compileMs = header.compileMs;
+        return true;
     }
 
-    void setMatrix4f(const std::string &name, const glm::mat4 &value) {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    void saveBinary(const uint64_t &key, const double &compileMs) const
+    {
+        if (!GLExtensions::hasProgramBinary()) return;
+
+        int length {0};
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+        std::vector<char> binary(length);
+        GLenum binaryFormat;
+        GLExtensions::getProgramBinary(ID, length, &length, &binaryFormat, binary.data());
+
+        BinaryHeader header;
+        std::memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+        header.key = key;
+        header.binaryFormat = binaryFormat;
+        header.length = length;
+        header.compileMs = compileMs;
+
+        // Written aside then renamed, so that an interrupted run never leaves a truncated entry
+        std::error_code ec;
+        std::filesystem::create_directories(binaryDir, ec);
+        std::string path = binaryPath(key), tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(binary.data(), length);
+            if (!file) return;
+        }
+        std::filesystem::rename(tmpPath, path, ec);
+    }
+
+    static double elapsedMs(const std::chrono::steady_clock::time_point &start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void introspectUniforms() const
+    {
+        int count {0}, maxLength {0};
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::string name(maxLength, '\0');
+        for (int i = 0; i < count; i++) {
+            GLsizei length {0};
+            UniformInfo info;
+            glGetActiveUniform(ID, i, maxLength, &length, &info.size, &info.type, &name[0]);
+            std::string uniformName = name.substr(0, length);
+            info.location = glGetUniformLocation(ID, uniformName.c_str());
+            // Members of uniform blocks have no location
+            if (info.location < 0) continue;
+            uniforms[uniformName] = info;
+            size_t arraySuffix = uniformName.rfind("[0]");
+            if (arraySuffix != std::string::npos && arraySuffix + 3 == uniformName.size())
+                uniforms[uniformName.substr(0, arraySuffix)] = info;
+        }
+    }
+
+    const UniformInfo *find(const std::string &name) const
+    {
+        finish();
+        auto it = uniforms.find(name);
+        if (it != uniforms.end()) return &it->second;
+        // Array elements other than the first are only known to the driver
+        if (name.find('[') == std::string::npos) return nullptr;
+        // Their type is the one of the first element, e.g. lights[0].color for lights[2].color
+        size_t open = name.find('['), close = name.find(']', open);
+        if (close == std::string::npos) return nullptr;
+        auto first = uniforms.find(name.substr(0, open) + "[0]" + name.substr(close + 1));
+        if (first == uniforms.end()) return nullptr;
+        UniformInfo info;
+        info.location = glGetUniformLocation(ID, name.c_str());
+        if (info.location < 0) return nullptr;
+        info.type = first->second.type;
+        return &(uniforms[name] = info);
+    }
+
+    int location(const std::string &name) const
+    {
+        const UniformInfo *info = find(name);
+        return info ? info->location : -1;
+    }
+
+    template <typename T>
+    static bool acceptsType(const GLenum &type);
+
+    static void upload(const int &location, const int &count, const bool *values)
+    {
+        for (int i = 0; i < count; i++) glUniform1i(location + i, values[i]);
+    }
+    static void upload(const int &location, const int &count, const int *values) { glUniform1iv(location, count, values); }
+    static void upload(const int &location, const int &count, const float *values) { glUniform1fv(location, count, values); }
+    static void upload(const int &location, const int &count, const glm::vec2 *values)
+    {
+        glUniform2fv(location, count, glm::value_ptr(values[0]));
+    }
+    static void upload(const int &location, const int &count, const glm::vec3 *values)
+    {
+        glUniform3fv(location, count, glm::value_ptr(values[0]));
+    }
+    static void upload(const int &location, const int &count, const glm::vec4 *values)
+    {
+        glUniform4fv(location, count, glm::value_ptr(values[0]));
+    }
+    static void upload(const int &location, const int &count, const glm::mat4 *values)
+    {
+        glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(values[0]));
     }
 };
 
-const std::string Shader::baseDir {"Shaders/"};
\ No newline at end of file
+template <> inline bool Shader::acceptsType<bool>(const GLenum &type) { return type == GL_BOOL; }
+template <> inline bool Shader::acceptsType<float>(const GLenum &type) { return type == GL_FLOAT; }
+template <> inline bool Shader::acceptsType<glm::vec2>(const GLenum &type) { return type == GL_FLOAT_VEC2; }
+template <> inline bool Shader::acceptsType<glm::vec3>(const GLenum &type) { return type == GL_FLOAT_VEC3; }
+template <> inline bool Shader::acceptsType<glm::vec4>(const GLenum &type) { return type == GL_FLOAT_VEC4; }
+template <> inline bool Shader::acceptsType<glm::mat4>(const GLenum &type) { return type == GL_FLOAT_MAT4; }
+// Samplers are set with texture unit numbers
+template <> inline bool Shader::acceptsType<int>(const GLenum &type)
+{
+    switch (type) {
+        case GL_INT: case GL_BOOL:
+        case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_CUBE_SHADOW: case GL_SAMPLER_BUFFER:
+            return true;
+        default:
+            return false;
+    }
+}
+
+const std::string Shader::baseDir {"Shaders/"};
+const std::string Shader::binaryDir {"Cache/Programs/"};
+Shader::CacheStats Shader::cacheStats;
+bool Shader::parallelCompile {true};
+std::unordered_map<std::string, std::shared_future<std::optional<std::string>>> Shader::preloaded;
+const std::string Shader::frameDataBlockName {"FrameData"};
\ No newline at end of file
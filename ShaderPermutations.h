@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Specialized programs built from the same stage files. Each feature key is a #define
+// switched on by one bit of the permutation mask; common defines go to every permutation.
+// Programs are built on first use and go through the program binary cache like any Shader.
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(const std::string &vertexPath, const std::string &geometryPath, const std::string &fragmentPath,
+                       const std::vector<std::string> &featureKeys, const Shader::Defines &commonDefines = Shader::Defines()) :
+        vertexPath(vertexPath), geometryPath(geometryPath), fragmentPath(fragmentPath),
+        featureKeys(featureKeys), commonDefines(commonDefines) {}
+
+    ShaderPermutations(const ShaderPermutations &) = delete;
+    ShaderPermutations &operator=(const ShaderPermutations &) = delete;
+
+    Shader &get(const uint32_t &features)
+    {
+        auto it = programs.find(features);
+        if (it != programs.end()) return *it->second;
+
+        Shader::Defines defines = commonDefines;
+        for (unsigned int i = 0; i < featureKeys.size(); i++)
+            if (features & (1u << i)) defines.push_back({featureKeys[i], "1"});
+        std::unique_ptr<Shader> shader = std::make_unique<Shader>(vertexPath.c_str(), geometryPath.c_str(),
+                                                                  fragmentPath.c_str(), defines);
+        return *programs.emplace(features, std::move(shader)).first->second;
+    }
+
+    // Submit every combination up front, to avoid compiling in the middle of a frame
+    void compileAll()
+    {
+        for (uint32_t features = 0; features < (1u << featureKeys.size()); features++)
+            get(features);
+    }
+
+    unsigned int size() { return programs.size(); }
+
+private:
+    std::string vertexPath, geometryPath, fragmentPath;
+    std::vector<std::string> featureKeys;
+    Shader::Defines commonDefines;
+    std::unordered_map<uint32_t, std::unique_ptr<Shader>> programs;
+};
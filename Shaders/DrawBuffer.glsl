@@ -0,0 +1,17 @@
+// Per-draw data of the indirect geometry path, std430 layout of DrawList::DrawData
+struct DrawData {
+    mat4 model;
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    // Shininess in w
+    vec4 specularColor;
+};
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+// Index of the draw in the draw buffer, from the base instance of its indirect command
+// (DrawList::drawIdAttribute)
+layout (location = 3) in uint vDrawId;
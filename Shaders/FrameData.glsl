@@ -0,0 +1,10 @@
+// Per-frame camera data shared by all programs, std140 layout of FrameData::Block (FrameData.h)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    vec3 cameraPos;
+    float time;
+    vec2 viewportSize;
+};
@@ -0,0 +1,32 @@
+// Normal encoding of the compact G-buffer (see RenderTargets::Layout): octahedral, mapped
+// to [0, 1] for a RG16 target. Written by the geometry pass, read through GBufferRead.glsl.
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.xy * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 encoded)
+{
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// Specular exponent in the alpha of the albedo target, log-encoded to [0, 1] so that a RGBA8
+// target keeps exponents up to maxShininess instead of clamping them to 1
+const float maxShininess = 2048.0;
+
+float encodeShininess(float shininess)
+{
+    return clamp(log2(max(shininess, 1.0)) / log2(maxShininess), 0.0, 1.0);
+}
+
+float decodeShininess(float encoded)
+{
+    return exp2(encoded * log2(maxShininess));
+}
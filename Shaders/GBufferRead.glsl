@@ -0,0 +1,34 @@
+// View space position and normal from the G-buffer, whatever its layout (see RenderTargets::Layout)
+#include "FrameData.glsl"
+#include "GBufferEncoding.glsl"
+
+#ifdef COMPACT_GBUFFER
+uniform sampler2D depthTex;
+#else
+uniform sampler2D positionTex;
+#endif
+uniform sampler2D normalTex;
+
+#ifdef COMPACT_GBUFFER
+// Rebuilt from depth
+vec3 viewPosition(vec2 uv)
+{
+    vec4 position = inverseProjection * vec4(vec3(uv, texture(depthTex, uv).r) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+vec3 viewNormal(vec2 uv)
+{
+    return decodeNormal(texture(normalTex, uv).rg);
+}
+#else
+vec3 viewPosition(vec2 uv)
+{
+    return texture(positionTex, uv).xyz;
+}
+
+vec3 viewNormal(vec2 uv)
+{
+    return normalize(texture(normalTex, uv).rgb);
+}
+#endif
@@ -0,0 +1,17 @@
+#version 430 core
+layout (location = 0) in vec3 vPos;
+
+#include "FrameData.glsl"
+#include "DrawBuffer.glsl"
+
+// Same position as geomIndirectVS.vert, see depthPrepassVS.vert
+invariant gl_Position;
+
+void main()
+{
+    DrawData draw = draws[vDrawId];
+
+    vec3 position = vPos * draw.positionScale.xyz + draw.positionOffset.xyz;
+    vec4 viewPos = view * draw.model * vec4(position, 1.0);
+    gl_Position = projection * viewPos;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 vPos;
+
+#include "FrameData.glsl"
+
+uniform mat4 model;
+// Compact vertices store positions relative to the mesh bounds (identity otherwise)
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+// The geometry pass tests against this depth with GL_EQUAL: both must compute the same
+// position, with the same expression as geomVS.vert
+invariant gl_Position;
+
+void main()
+{
+    vec3 position = vPos * positionScale + positionOffset;
+    vec4 viewPos = view * model * vec4(position, 1.0);
+    gl_Position = projection * viewPos;
+}
@@ -0,0 +1,90 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 FragTexCoords;
+
+// Lit scene, rendered below the window resolution (see RenderTargets)
+uniform sampler2D sceneTex;
+
+// Edge-adaptive spatial upscaling, in the spirit of FSR 1 EASU: each output pixel filters the
+// 4x4 nearest input texels with a Lanczos-like kernel, stretched along the local edge so that
+// edges stay sharp instead of being blurred across. The scene is already tone mapped.
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+// Lanczos 2 approximation from FSR, without any transcendental: d2 is the squared distance,
+// lobe the negative lobe strength and clipping the distance where the kernel is cut
+float kernelWeight(vec2 offset, vec2 direction, vec2 scale, float lobe, float clipping)
+{
+    // Offset in the edge frame: x across the edge, y along it
+    vec2 v = vec2(dot(offset, direction), dot(offset, vec2(-direction.y, direction.x))) * scale;
+    float d2 = min(dot(v, v), clipping);
+    float base = 0.4 * d2 - 1.0;
+    float window = (25.0 / 16.0) * base * base - (25.0 / 16.0 - 1.0);
+    float lobeTerm = lobe * d2 - 1.0;
+    return window * lobeTerm * lobeTerm;
+}
+
+void main()
+{
+    ivec2 inputSize = textureSize(sceneTex, 0);
+    // Position in input texels, relative to the center of texel (0, 0)
+    vec2 position = FragTexCoords * vec2(inputSize) - 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - vec2(base);
+
+    // 4x4 neighbourhood, from base - 1 to base + 2
+    vec3 colors[16];
+    float lumas[16];
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            ivec2 texel = clamp(base + ivec2(x - 1, y - 1), ivec2(0), inputSize - 1);
+            colors[y * 4 + x] = texelFetch(sceneTex, texel, 0).rgb;
+            lumas[y * 4 + x] = luma(colors[y * 4 + x]);
+        }
+    }
+
+    // Luma gradient at the 4 center texels, bilinearly blended at the output position
+    vec2 gradients[4];
+    float minLuma = 1.0, maxLuma = 0.0;
+    for (int y = 1; y <= 2; y++) {
+        for (int x = 1; x <= 2; x++) {
+            int i = y * 4 + x;
+            gradients[(y - 1) * 2 + (x - 1)] = vec2(lumas[i + 1] - lumas[i - 1], lumas[i + 4] - lumas[i - 4]);
+            minLuma = min(minLuma, lumas[i]);
+            maxLuma = max(maxLuma, lumas[i]);
+        }
+    }
+    vec2 gradient = mix(mix(gradients[0], gradients[1], f.x), mix(gradients[2], gradients[3], f.x), f.y);
+    float gradientLength2 = dot(gradient, gradient);
+    vec2 direction = gradientLength2 < 1.0 / 32768.0 ? vec2(1.0, 0.0) : gradient * inversesqrt(gradientLength2);
+
+    // Edge strength from 0 (flat or noisy) to 1 (clean edge), relative to the local contrast
+    float edge = clamp(0.5 * sqrt(gradientLength2) / max(maxLuma - minLuma, 1.0 / 256.0), 0.0, 1.0);
+    edge *= edge;
+    // Diagonal edges would get a narrower kernel than axis-aligned ones: undo the square shape
+    float stretch = 1.0 / max(abs(direction.x), abs(direction.y));
+    vec2 scale = vec2(1.0 + (stretch - 1.0) * edge, 1.0 - 0.5 * edge);
+    // Sharper negative lobe on edges
+    float lobe = 0.5 - 0.29 * edge;
+    float clipping = 1.0 / lobe;
+
+    vec3 total = vec3(0.0);
+    float totalWeight = 0.0;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            float weight = kernelWeight(vec2(x - 1, y - 1) - f, direction, scale, lobe, clipping);
+            total += colors[y * 4 + x] * weight;
+            totalWeight += weight;
+        }
+    }
+    vec3 color = total / totalWeight;
+
+    // Remove ringing: stay within the 4 nearest texels
+    vec3 minColor = min(min(colors[5], colors[6]), min(colors[9], colors[10]));
+    vec3 maxColor = max(max(colors[5], colors[6]), max(colors[9], colors[10]));
+    FragColor = vec4(clamp(color, minColor, maxColor), 1.0);
+}
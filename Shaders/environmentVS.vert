@@ -1,8 +1,7 @@
 #version 330 core
 layout (location = 0) in vec3 vPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "FrameData.glsl"
 
 out vec3 localPos;
 
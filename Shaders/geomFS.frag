@@ -1,7 +1,14 @@
 #version 330 core
+// G-buffer layout, see RenderTargets::Layout. The compact one has no position: it is
+// rebuilt from depth by the lighting passes.
+#ifdef COMPACT_GBUFFER
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+#else
 layout (location = 0) out vec3 gPosition;
 layout (location = 1) out vec3 gNormal;
 layout (location = 2) out vec4 gAlbedoSpec;
+#endif
 
 in VertexData {
 	vec3 FragPos;
@@ -9,11 +16,11 @@ in VertexData {
 	vec2 FragTexCoords;
 } fs_in;
 
+// Texture presence is a compile-time permutation (HAS_DIFFUSE_TEX, HAS_SPECULAR_TEX),
+// see DrawPacket::Feature
 struct Material {
 	sampler2D diffuseTex;
 	sampler2D specularTex;
-	bool hasDiffuseTex;
-	bool hasSpecularTex;
 
 	vec3 ambientColor;
 	vec3 diffuseColor;
@@ -23,12 +30,25 @@ struct Material {
 };
 uniform Material material;
 
+#include "GBufferEncoding.glsl"
+
 void main() 
 {
+#ifdef COMPACT_GBUFFER
+	gNormal = encodeNormal(normalize(fs_in.FragNormal));
+#else
 	gPosition = fs_in.FragPos;
 	gNormal = normalize(fs_in.FragNormal);
-	gAlbedoSpec.rgb = material.hasDiffuseTex ? 
-		texture(material.diffuseTex, fs_in.FragTexCoords).rgb : material.diffuseColor;
-	gAlbedoSpec.a = material.hasSpecularTex ? 
-		texture(material.specularTex, fs_in.FragTexCoords).r : material.shininess;
+#endif
+#ifdef HAS_DIFFUSE_TEX
+	gAlbedoSpec.rgb = texture(material.diffuseTex, fs_in.FragTexCoords).rgb;
+#else
+	gAlbedoSpec.rgb = material.diffuseColor;
+#endif
+	// The specular map scales the exponent of the material
+#ifdef HAS_SPECULAR_TEX
+	gAlbedoSpec.a = encodeShininess(material.shininess * texture(material.specularTex, fs_in.FragTexCoords).r);
+#else
+	gAlbedoSpec.a = encodeShininess(material.shininess);
+#endif
 }
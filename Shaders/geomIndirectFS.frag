@@ -0,0 +1,50 @@
+#version 430 core
+// G-buffer layout, see RenderTargets::Layout. The compact one has no position: it is
+// rebuilt from depth by the lighting passes.
+#ifdef COMPACT_GBUFFER
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+#else
+layout (location = 0) out vec3 gPosition;
+layout (location = 1) out vec3 gNormal;
+layout (location = 2) out vec4 gAlbedoSpec;
+#endif
+
+in VertexData {
+	vec3 FragPos;
+	vec3 FragNormal;
+	vec2 FragTexCoords;
+} fs_in;
+
+flat in vec3 DiffuseColor;
+flat in float Shininess;
+
+// Shared by every draw of a multi-draw call: DrawList splits batches on texture changes
+struct Material {
+	sampler2D diffuseTex;
+	sampler2D specularTex;
+};
+uniform Material material;
+
+#include "GBufferEncoding.glsl"
+
+void main()
+{
+#ifdef COMPACT_GBUFFER
+	gNormal = encodeNormal(normalize(fs_in.FragNormal));
+#else
+	gPosition = fs_in.FragPos;
+	gNormal = normalize(fs_in.FragNormal);
+#endif
+	// Same texture presence permutations as geomFS.frag
+#ifdef HAS_DIFFUSE_TEX
+	gAlbedoSpec.rgb = texture(material.diffuseTex, fs_in.FragTexCoords).rgb;
+#else
+	gAlbedoSpec.rgb = DiffuseColor;
+#endif
+#ifdef HAS_SPECULAR_TEX
+	gAlbedoSpec.a = encodeShininess(Shininess * texture(material.specularTex, fs_in.FragTexCoords).r);
+#else
+	gAlbedoSpec.a = encodeShininess(Shininess);
+#endif
+}
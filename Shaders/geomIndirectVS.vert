@@ -0,0 +1,39 @@
+#version 430 core
+layout (location = 0) in vec3 vPos;
+layout (location = 1) in vec3 vNormal;
+layout (location = 2) in vec2 vTexCoords;
+
+out VertexData {
+    vec3 FragPos;
+    vec3 FragNormal;
+    vec2 FragTexCoords;
+} vs_out;
+
+// Material of the draw, constant over each draw
+flat out vec3 DiffuseColor;
+flat out float Shininess;
+
+#include "FrameData.glsl"
+#include "DrawBuffer.glsl"
+
+// Must stay equal to the depth pre-pass position (depthPrepassVS.vert)
+invariant gl_Position;
+
+void main()
+{
+    DrawData draw = draws[vDrawId];
+
+    vec3 position = vPos * draw.positionScale.xyz + draw.positionOffset.xyz;
+    vec4 viewPos = view * draw.model * vec4(position, 1.0);
+    vs_out.FragPos = viewPos.xyz;
+
+    mat3 normalMat = mat3(transpose(inverse(view * draw.model)));
+    vs_out.FragNormal = normalMat * vNormal;
+
+    vs_out.FragTexCoords = vTexCoords;
+
+    DiffuseColor = draw.diffuseColor.rgb;
+    Shininess = draw.specularColor.a;
+
+    gl_Position = projection * viewPos;
+}
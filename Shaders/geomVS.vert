@@ -10,12 +10,19 @@ out VertexData {
 } vs_out;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "FrameData.glsl"
+
+// Compact vertices store positions relative to the mesh bounds (identity otherwise)
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+// Must stay equal to the depth pre-pass position (depthPrepassVS.vert)
+invariant gl_Position;
 
 void main() 
 {
-    vec4 viewPos = view * model * vec4(vPos, 1.0);
+    vec3 position = vPos * positionScale + positionOffset;
+    vec4 viewPos = view * model * vec4(position, 1.0);
     vs_out.FragPos = viewPos.xyz;
 
     mat3 normalMat = mat3(transpose(inverse(view * model)));
@@ -5,8 +5,7 @@ in vec2 FragTexCoords;
 
 uniform samplerCube cubeMap;
 
-uniform sampler2D positionTex;
-uniform sampler2D normalTex;
+#include "GBufferRead.glsl"
 uniform sampler2D colorSpecTex;
 
 uniform sampler2D ssaoTex;
@@ -15,9 +14,6 @@ uniform samplerCube irradianceMap;
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLut;
 
-uniform vec3 cameraPos;
-uniform mat4 view;
-
 struct Light {
 	vec3 position;
 	float farPlane;
@@ -35,7 +31,6 @@ struct Attenuation {
 uniform Attenuation attenuation;
 
 #define PI 3.1415926535897932
-const float Roughness = 0.2;
 const vec3 F0 = vec3(0.2);
 // Metallic surface (= 1.0 if metallic)
 const float Metallic = 0.0;
@@ -94,9 +89,15 @@ vec3 fresnelSchlickRoughness(vec3 normal, vec3 viewDir, vec3 f0, float roughness
 	return f0 + (max(vec3(1.0 - roughness), f0) - f0) * pow(1.0 - cosTheta, 5.0);
 }
 
-vec3 computeEnvLight(vec3 irradiance, vec4 albedoSpec, vec3 normal, vec3 fragPos, vec3 viewDir, float ao)
+// GGX roughness matching a Blinn-Phong specular exponent
+float shininessToRoughness(float shininess)
+{
+	return sqrt(2.0 / (shininess + 2.0));
+}
+
+vec3 computeEnvLight(vec3 irradiance, vec4 albedoSpec, vec3 normal, vec3 fragPos, vec3 viewDir, float ao, float roughness)
 {
-	vec3 f = fresnelSchlickRoughness(normal, viewDir, F0, Roughness);
+	vec3 f = fresnelSchlickRoughness(normal, viewDir, F0, roughness);
 
 	// fresnel term determines the reflected energy factor ks (energy preservation)
 	vec3 kd = vec3(1.0) - f; 
@@ -106,17 +107,17 @@ vec3 computeEnvLight(vec3 irradiance, vec4 albedoSpec, vec3 normal, vec3 fragPos
 	return ambient;
 }
 
-vec3 computePointLight(Light light, vec4 albedoSpec, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 computePointLight(Light light, vec4 albedoSpec, vec3 normal, vec3 fragPos, vec3 viewDir, float roughness)
 {
 	vec3 lightDir = normalize(light.position - fragPos);
 
 	// Cook-Torrance BRDF
 	// Compute from view (viewPos = vec(0.0))
 	vec3 halfDir = normalize(lightDir + viewDir);
-	float d = normalDistribFunc(normal, halfDir, Roughness);
+	float d = normalDistribFunc(normal, halfDir, roughness);
 	vec3 f 	= fresnelFunc(halfDir, viewDir, F0);
 	// Take geometry obstruction and geometry shadowing into account
-	float g = geometryFunc(normal, viewDir, Roughness) * geometryFunc(normal, lightDir, Roughness);
+	float g = geometryFunc(normal, viewDir, roughness) * geometryFunc(normal, lightDir, roughness);
 	float denom = 4.0 * max(dot(viewDir, normal), 0.0) * max(dot(lightDir, normal), 0.0);
 	vec3 specular = (d * f * g) / max(denom, 0.001);
 
@@ -135,25 +136,27 @@ vec3 computePointLight(Light light, vec4 albedoSpec, vec3 normal, vec3 fragPos,
 void main()
 {
     vec4 albedoSpec = texture(colorSpecTex, FragTexCoords);
-    vec3 normal 	= normalize(texture(normalTex, FragTexCoords).rgb);
-    vec3 position 	= texture(positionTex, FragTexCoords).rgb;
+    vec3 normal 	= viewNormal(FragTexCoords);
+    vec3 position 	= viewPosition(FragTexCoords);
     vec3 viewDir 	= normalize(-position);
 	float ao 		= texture(ssaoTex, FragTexCoords).r;
+	// Specular exponent written by the geometry pass
+	float roughness = shininessToRoughness(decodeShininess(albedoSpec.a));
 	vec3 irradiance = texture(irradianceMap, normal).rgb;
 
 	if (albedoSpec.rgb == vec3(0.0)) discard;
 
 	// Diffuse environment part
-	vec3 diffuseEnvColor = computeEnvLight(irradiance, albedoSpec, normal, position, viewDir, ao);
+	vec3 diffuseEnvColor = computeEnvLight(irradiance, albedoSpec, normal, position, viewDir, ao, roughness);
 
 	// Specular environment part
 	vec3 incident = reflect(-viewDir, normal);
 	// Prefiltered environment map was computed with 5 lods (0 to 4)
 	const float MAX_REFLECTION_LOD = 4.0;
-	vec3 prefilteredColor = textureLod(prefilterMap, incident, Roughness * MAX_REFLECTION_LOD).rgb;
+	vec3 prefilteredColor = textureLod(prefilterMap, incident, roughness * MAX_REFLECTION_LOD).rgb;
 	float n_dot_v = max(dot(normal, viewDir), 0.0);
-	vec2 brdfFactors = texture(brdfLut, vec2(n_dot_v, Roughness)).rg;
-	vec3 f = fresnelSchlickRoughness(normal, viewDir, F0, Roughness);
+	vec2 brdfFactors = texture(brdfLut, vec2(n_dot_v, roughness)).rg;
+	vec3 f = fresnelSchlickRoughness(normal, viewDir, F0, roughness);
 	vec3 specEnvColor = prefilteredColor * (f * brdfFactors.x + brdfFactors.y);
 
 	vec3 kd = vec3(1.0) - f;
@@ -3,8 +3,7 @@ layout (location = 0) in vec3 aPos;
 out vec3 vPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "FrameData.glsl"
 
 void main() 
 {
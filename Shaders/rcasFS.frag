@@ -0,0 +1,38 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 FragTexCoords;
+
+// Upscaled scene, at the window resolution
+uniform sampler2D upscaledTex;
+// In stops: 0 is the strongest, each stop halves the sharpening
+uniform float sharpness;
+
+// Contrast-adaptive sharpening, in the spirit of FSR 1 RCAS: a 5 tap cross whose negative
+// lobe is as strong as possible without pushing any channel out of the [0, 1] range, so
+// flat areas and strong edges are left alone.
+
+// Strongest lobe, a bit below 1/4 to avoid artifacts
+const float maxLobe = 0.25 - 1.0 / 16.0;
+
+void main()
+{
+    ivec2 size = textureSize(upscaledTex, 0);
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec3 b = texelFetch(upscaledTex, clamp(texel + ivec2(0, 1), ivec2(0), size - 1), 0).rgb;
+    vec3 d = texelFetch(upscaledTex, clamp(texel - ivec2(1, 0), ivec2(0), size - 1), 0).rgb;
+    vec3 e = texelFetch(upscaledTex, texel, 0).rgb;
+    vec3 f = texelFetch(upscaledTex, clamp(texel + ivec2(1, 0), ivec2(0), size - 1), 0).rgb;
+    vec3 h = texelFetch(upscaledTex, clamp(texel - ivec2(0, 1), ivec2(0), size - 1), 0).rgb;
+
+    vec3 minRing = min(min(b, d), min(f, h));
+    vec3 maxRing = max(max(b, d), max(f, h));
+    // Lobe reaching 0 or 1 exactly, per channel
+    vec3 hitMin = minRing / (4.0 * maxRing + 1.0 / 65536.0);
+    vec3 hitMax = (1.0 - maxRing) / (4.0 * minRing - 4.0 - 1.0 / 65536.0);
+    vec3 lobeRgb = max(-hitMin, hitMax);
+    float lobe = max(-maxLobe, min(max(lobeRgb.r, max(lobeRgb.g, lobeRgb.b)), 0.0)) * exp2(-sharpness);
+
+    vec3 color = (lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0);
+    FragColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
@@ -7,7 +7,7 @@ in VertexData {
 
 out vec4 FragColor;
 
-uniform vec3 cameraPos;
+#include "FrameData.glsl"
 
 struct Material {
 	sampler2D diffuseTex;
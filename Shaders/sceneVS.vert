@@ -10,8 +10,7 @@ out VertexData {
 } vs_out;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "FrameData.glsl"
 
 void main() 
 {
@@ -3,25 +3,26 @@ out float FragAO;
 
 in vec2 FragTexCoords;
 
-uniform sampler2D positionTex;
-uniform sampler2D normalTex;
+#include "GBufferRead.glsl"
 
 uniform sampler2D noiseTex;
 
-const int kernelSize = 64;
+// Sample count, chosen from the quality tier (see ScreenSpaceAO::kernelSizeFor)
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 64
+#endif
+const int kernelSize = KERNEL_SIZE;
 uniform vec3 kernelSamples[kernelSize];
 
-uniform mat4 view;
-uniform mat4 projection;
-
-const vec2 noiseScale = vec2(1920.0 / 4.0, 1080.0 / 4.0);
 const float radius = 0.5;
 const float bias = 0.025;
 
 void main()
 {
-    vec3 fragPos = texture(positionTex, FragTexCoords).xyz;
-    vec3 normal = normalize(texture(normalTex, FragTexCoords)).rgb;
+    // Tile the 4x4 noise texture over the screen
+    vec2 noiseScale = viewportSize / 4.0;
+    vec3 fragPos = viewPosition(FragTexCoords);
+    vec3 normal = viewNormal(FragTexCoords);
     vec3 randomRotationVector = normalize(texture(noiseTex, FragTexCoords * noiseScale).xyz);
 
     // TBN orthonormal basis (gramm-schmidt process)
@@ -39,7 +40,7 @@ void main()
         offsetFragPos.xyz /= offsetFragPos.w;
         // Map view space values to texture space ([-1; 1] => [0; 1])
         offsetFragPos.xyz = offsetFragPos.xyz * 0.5 + 0.5;
-        float sampleDepth = texture(positionTex, offsetFragPos.xy).z;
+        float sampleDepth = viewPosition(offsetFragPos.xy).z;
         // Remove effect of fragments far behind or in front of current fragment
         //float rangeDiscardFactor = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
         float rangeDiscardFactor = 1.0;
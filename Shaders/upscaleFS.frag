@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 FragTexCoords;
+
+// Lit scene, rendered below the window resolution (see RenderTargets)
+uniform sampler2D sceneTex;
+
+void main()
+{
+    // Bilinear filtering of the texture does the upscaling
+    FragColor = vec4(texture(sceneTex, FragTexCoords).rgb, 1.0);
+}
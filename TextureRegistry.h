@@ -0,0 +1,105 @@
+#pragma once
+
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide table of GL textures loaded from files, shared by every Model.
+// Textures are found either by canonical file path or by content hash (same image
+// under different names), and are deleted when their last user releases them.
+class TextureRegistry
+{
+private:
+    struct Entry {
+        unsigned int refCount {0};
+        uint64_t contentHash {0};
+        // False for files that failed to load, only known by path
+        bool byContent {true};
+    };
+
+    std::unordered_map<std::string, unsigned int> idsByPath;
+    std::unordered_map<uint64_t, unsigned int> idsByContent;
+    std::unordered_map<unsigned int, Entry> entries;
+    // Lookups may come from decoding worker threads
+    std::mutex mutex;
+
+    TextureRegistry() {}
+
+public:
+    static TextureRegistry &instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    static std::string canonicalPath(const std::string &path)
+    {
+        std::error_code ec;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+        return ec ? path : canonical.string();
+    }
+
+    // Returns the texture already loaded from this file and takes a reference on it, or 0
+    unsigned int acquireByPath(const std::string &canonicalPath)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = idsByPath.find(canonicalPath);
+        if (it == idsByPath.end()) return 0;
+        entries[it->second].refCount++;
+        return it->second;
+    }
+
+    // Same as above for a file whose content is identical to an already loaded one.
+    // The path becomes an alias so that the next lookup does not need to read the file.
+    unsigned int acquireByContent(const std::string &canonicalPath, const uint64_t &contentHash)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = idsByContent.find(contentHash);
+        if (it == idsByContent.end()) return 0;
+        entries[it->second].refCount++;
+        idsByPath.emplace(canonicalPath, it->second);
+        return it->second;
+    }
+
+    // Register a freshly uploaded texture, with a first reference owned by the caller. Files
+    // that could not be read or decoded are registered by path only: their content hash says
+    // nothing about the image (all missing files hash the same), so they must never alias.
+    void add(const std::string &canonicalPath, const uint64_t &contentHash, const unsigned int &id,
+             const bool &byContent = true)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idsByPath[canonicalPath] = id;
+        if (byContent) idsByContent[contentHash] = id;
+        Entry &entry = entries[id];
+        entry.refCount = 1;
+        entry.contentHash = contentHash;
+        entry.byContent = byContent;
+    }
+
+    void release(const unsigned int &id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(id);
+        if (it == entries.end() || --it->second.refCount > 0) return;
+
+        for (auto pathIt = idsByPath.begin(); pathIt != idsByPath.end();) {
+            if (pathIt->second == id) pathIt = idsByPath.erase(pathIt);
+            else ++pathIt;
+        }
+        if (it->second.byContent) idsByContent.erase(it->second.contentHash);
+        entries.erase(it);
+        GLState::deleteTextures(1, &id);
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads for CPU-only jobs (never issue GL calls from a task)
+class ThreadPool
+{
+public:
+    // Threads are labelled "name i" in CPU traces
+    explicit ThreadPool(unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency()),
+                        const std::string &name = "Worker")
+    {
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this, name, i] {
+                CPU_PROFILE_THREAD(name + " " + std::to_string(i));
+                workerLoop();
+            });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    template <typename F>
+    auto submit(F &&task) -> std::future<decltype(task())>
+    {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push([packaged] { (*packaged)(); });
+        }
+        condition.notify_one();
+        return result;
+    }
+
+    unsigned int size() { return workers.size(); }
+
+    // Pool shared by the whole application, sized on the number of cores
+    static ThreadPool &shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping {false};
+
+    void workerLoop()
+    {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+};
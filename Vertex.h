@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+};
+
+// 16-byte alternative to Vertex:
+// - position as unsigned normalized 16-bit values relative to the mesh bounds,
+// - normal as signed normalized GL_INT_2_10_10_10_REV,
+// - texture coordinates as half floats.
+struct CompactVertex {
+    uint16_t position[4];
+    uint32_t normal;
+    uint16_t texCoords[2];
+};
+
+enum class VertexFormat : uint32_t { Full, Compact };
+
+inline size_t vertexSize(const VertexFormat &format)
+{
+    return format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+// Attribute pointers for the currently bound GL_ARRAY_BUFFER, into the currently bound vertex array
+inline void setupVertexAttributes(const VertexFormat &format)
+{
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    if (format == VertexFormat::Compact) {
+        // Normalized attributes: positions land in [0; 1] and are rescaled by the vertex shader
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, position));
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, texCoords));
+    }
+    else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    }
+}
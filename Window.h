@@ -0,0 +1,68 @@
+#pragma once
+
+#include "GLExtensions.h"
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <iostream>
+#include <string>
+
+// Surface the application renders to, owning the GL context: an on-screen window
+// (GlfwWindow) or an offscreen framebuffer without any display (HeadlessWindow).
+// The GL context is current and loaded once a backend has been created successfully.
+class Window
+{
+public:
+    enum class Key { Escape, W, A, S, D, P };
+
+    // Optional input and resize notifications, called from pollEvents()
+    struct Callbacks {
+        std::function<void(int width, int height)> resize;
+        std::function<void(double x, double y)> mouseMove;
+        std::function<void(double dy)> scroll;
+        std::function<void(Key key)> keyPressed;
+    };
+
+    virtual ~Window() {}
+
+    Window(const Window &) = delete;
+    Window &operator=(const Window &) = delete;
+
+    virtual bool shouldClose() = 0;
+    virtual void requestClose() = 0;
+    // Present the frame rendered into getFramebuffer()
+    virtual void swapBuffers() = 0;
+    virtual void pollEvents() = 0;
+    virtual bool isKeyDown(const Key &key) = 0;
+    virtual void setTitle(const std::string &title) = 0;
+    // Seconds since the window was created
+    virtual double getTime() = 0;
+    // Wait for the display refresh when presenting. Nothing to wait for offscreen.
+    virtual void setVsync(const bool &enabled) {}
+
+    // Framebuffer standing for the screen: 0 for an on-screen window
+    virtual unsigned int getFramebuffer() { return 0; }
+
+    unsigned int getWidth() { return width; }
+    unsigned int getHeight() { return height; }
+
+    void setCallbacks(const Callbacks &newCallbacks) { callbacks = newCallbacks; }
+
+protected:
+    unsigned int width, height;
+    Callbacks callbacks;
+
+    Window(const unsigned int &width, const unsigned int &height) : width(width), height(height) {}
+
+    // Load GL entry points with the backend's loader, the context being current
+    static bool loadGL(GLADloadproc loader)
+    {
+        if (!gladLoadGLLoader(loader)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        GLExtensions::load(loader);
+        return true;
+    }
+};
@@ -1,13 +1,30 @@
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <cstdio>
+#include <chrono>
 #include <memory>
 
 #include "Shader.h"
+#include "Benchmark.h"
 #include "Camera.h"
+#include "CameraPath.h"
+#include "CpuProfiler.h"
+#include "DepthPrepass.h"
 #include "LightTypes.h"
+#include "DrawList.h"
+#include "DynamicResolution.h"
+#include "FrameData.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#ifndef HEADLESS_ONLY
+#include "GlfwWindow.h"
+#endif
+#include "GpuProfiler.h"
+#include "HeadlessWindow.h"
 #include "Model.h"
+#include "ModelLoader.h"
+#include "RenderTargets.h"
 #include "ScreenSpaceAO.h"
 #include "DrawUtils.h"
 #include "ImageBasedLighting.h"
@@ -17,7 +34,10 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
 
-const unsigned int screenWidth{1920}, screenHeight{1080};
+// Requested with --resolution, then actual size of the window framebuffer
+unsigned int screenWidth{1920}, screenHeight{1080};
+const unsigned int defaultHeadlessFrames{300};
+const unsigned int defaultBenchmarkFrames{500};
 
 // Mouse interaction
 float lastX, lastY;
@@ -28,11 +48,15 @@ float deltaTime{0.0f},
 		lastFrameTime{0.0f};
 
 std::unique_ptr<Camera> camera;
-std::unique_ptr<Model> objectModel;
+// View, projection and time shared by every program
+FrameData frameData;
+// Sorted model draws of the geometry pass
+DrawList drawList;
+// Live GPU timings report, toggled with P
+bool showGpuTimings{false};
 
-// Deferred shading geometry pass
-unsigned int gFrameBuffer, gRenderBuffer;
-unsigned int gPositionTex, gNormalTex, gColorSpecTex;
+// G-buffer and SSAO targets, following the window size
+std::unique_ptr<RenderTargets> renderTargets;
 
 // Buffers for simple geometry to be rendered
 unsigned int quadVAO{0};
@@ -40,43 +64,135 @@ unsigned int quadVBO;
 unsigned int cubeVAO{0};
 unsigned int cubeVBO;
 
-// GLFW callback functions
-void framebuffer_size_callback(GLFWwindow *window, int width, int height);
-void mouse_callback(GLFWwindow *window, double mouseX, double mouseY);
-void scroll_callback(GLFWwindow *window, double dx, double dy);
+// Window callback functions
+void framebuffer_size_callback(int width, int height);
+void mouse_callback(double mouseX, double mouseY);
+void scroll_callback(double dy);
+void key_callback(Window::Key key);
 
-void processInput(GLFWwindow *window);
-void renderScene(Shader &shader);
-void initGeometryPass();
+void processInput(Window &window);
+void renderScene(ModelLoader::Handle &objectModel, Shader &shader, ShaderPermutations &modelShaders);
 
 int main(int argc, char *argv[])
 {
-	glfwInit();
-	// Set running versions of OpenGL
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	GLFWwindow *window = glfwCreateWindow(screenWidth, screenHeight, "Hello OpenGL", glfwGetPrimaryMonitor(), NULL);
-	if (window == NULL)
+	// Time to first frame, to compare startup with and without parallel shader compilation
+	auto startupTime = std::chrono::steady_clock::now();
+	CPU_PROFILE_THREAD("Main");
+
+	std::string modelPath = argv[1];
+	std::string iblImagePath = argv[2];
+	// Optional quality tier: low, medium or high (default), --serial-shaders to build
+	// programs one after the other, --gpu-csv <path> to export GPU timings on exit,
+	// --cpu-trace <path> to export CPU zones (builds with -DCPU_PROFILER), --headless to
+	// render offscreen without a display, --resolution <width>x<height> and --frames <count>
+	// to stop after a number of frames.
+	// --benchmark measures --frames frames along --camera-path <path> (an orbit around the
+	// model by default) and writes the results to --benchmark-out <path>, then compares them
+	// with --baseline <path> when given, failing above --threshold <percent> of slowdown.
+	// --record-path <path> saves the camera placement of every interactive frame.
+	// --dynamic-resolution <ms> lowers the render scale (down to 50%) to keep GPU frame time
+	// under the given budget, --render-scale <percent> fixes it instead. Below 100%, the scene
+	// is upscaled with --upscaler edge (default, edge-adaptive then sharpened by --sharpness
+	// <stops>, 0 being the strongest) or bilinear. --gbuffer classic keeps the G-buffer with
+	// a position texture instead of the compact layout. --depth-prepass on|off|auto draws the
+	// depth of the scene before filling the G-buffer, auto keeping it while overdraw is high.
+	ScreenSpaceAO::Quality quality = ScreenSpaceAO::Quality::High;
+	std::string gpuCsvPath, cpuTracePath;
+	bool headless{false};
+	unsigned int maxFrames{0};
+	bool benchmarkMode{false};
+	std::string benchmarkOutPath{"benchmark.json"}, baselinePath, cameraPathFile, recordPathFile;
+	double regressionThreshold{5.0};
+	double frameBudgetMs{0.0};
+	float renderScale{1.0f}, sharpness{0.2f};
+	bool edgeUpscaler{true};
+	RenderTargets::Layout gBufferLayout{RenderTargets::Layout::Compact};
+	DepthPrepass::Mode prepassMode{DepthPrepass::Mode::Off};
+	for (int i = 3; i < argc; i++)
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return -1;
+		std::string option = argv[i];
+		if (option == "low")
+			quality = ScreenSpaceAO::Quality::Low;
+		else if (option == "medium")
+			quality = ScreenSpaceAO::Quality::Medium;
+		else if (option == "--serial-shaders")
+			Shader::parallelCompile = false;
+		else if (option == "--gpu-csv" && i + 1 < argc)
+			gpuCsvPath = argv[++i];
+		else if (option == "--cpu-trace" && i + 1 < argc)
+			cpuTracePath = argv[++i];
+		else if (option == "--headless")
+			headless = true;
+		else if (option == "--resolution" && i + 1 < argc)
+			std::sscanf(argv[++i], "%ux%u", &screenWidth, &screenHeight);
+		else if (option == "--frames" && i + 1 < argc)
+			maxFrames = std::stoul(argv[++i]);
+		else if (option == "--benchmark")
+			benchmarkMode = true;
+		else if (option == "--benchmark-out" && i + 1 < argc)
+			benchmarkOutPath = argv[++i];
+		else if (option == "--baseline" && i + 1 < argc)
+			baselinePath = argv[++i];
+		else if (option == "--threshold" && i + 1 < argc)
+			regressionThreshold = std::stod(argv[++i]);
+		else if (option == "--camera-path" && i + 1 < argc)
+			cameraPathFile = argv[++i];
+		else if (option == "--record-path" && i + 1 < argc)
+			recordPathFile = argv[++i];
+		else if (option == "--dynamic-resolution" && i + 1 < argc)
+			frameBudgetMs = std::stod(argv[++i]);
+		else if (option == "--render-scale" && i + 1 < argc)
+			renderScale = std::stof(argv[++i]) / 100.0f;
+		else if (option == "--upscaler" && i + 1 < argc)
+			edgeUpscaler = std::string(argv[++i]) != "bilinear";
+		else if (option == "--gbuffer" && i + 1 < argc)
+			gBufferLayout = std::string(argv[++i]) == "classic" ? RenderTargets::Layout::Classic
+				: RenderTargets::Layout::Compact;
+		else if (option == "--sharpness" && i + 1 < argc)
+			sharpness = std::stof(argv[++i]);
+		else if (option == "--depth-prepass" && i + 1 < argc)
+			prepassMode = DepthPrepass::parseMode(argv[++i]);
 	}
-	// Tell GLFW to make the context of our window the main context of current thread
-	glfwMakeContextCurrent(window);
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-	{
-		std::cout << "Failed to initialize GLAD" << std::endl;
+#ifdef HEADLESS_ONLY
+	// Built without GLFW (make headless): there is no other backend
+	headless = true;
+#endif
+	// Benchmarks stop by themselves once every frame is measured
+	if (benchmarkMode && maxFrames == 0)
+		maxFrames = defaultBenchmarkFrames;
+	// Headless runs have no way to be closed by hand
+	if (headless && maxFrames == 0)
+		maxFrames = defaultHeadlessFrames;
+	CameraPath cameraPath;
+	if (!cameraPathFile.empty() && !cameraPath.load(cameraPathFile))
 		return -1;
-	}
-	// Always set callbacks after having created the window
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	// Enable cursor capture for input callbacks (& hide hint)
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-	// Scroll callback
-	glfwSetScrollCallback(window, scroll_callback);
+
+	// Both backends try an OpenGL 4.3 context first, for the multi-draw-indirect geometry
+	// pass, then 3.3 which is enough for everything else
+	std::unique_ptr<Window> window;
+	auto phaseStart = std::chrono::steady_clock::now();
+	if (headless)
+		window = HeadlessWindow::create(screenWidth, screenHeight);
+#ifndef HEADLESS_ONLY
+	else
+		window = GlfwWindow::create(screenWidth, screenHeight, "Hello OpenGL");
+#endif
+	if (!window)
+		return -1;
+	// The framebuffer may differ from the requested size (fullscreen mode, high DPI)
+	screenWidth = window->getWidth();
+	screenHeight = window->getHeight();
+	Window::Callbacks callbacks;
+	callbacks.resize = framebuffer_size_callback;
+	callbacks.mouseMove = mouse_callback;
+	callbacks.scroll = scroll_callback;
+	// P toggles the live GPU timings report
+	callbacks.keyPressed = key_callback;
+	window->setCallbacks(callbacks);
+	// Frame times of a benchmark must not depend on the display refresh rate
+	if (benchmarkMode)
+		window->setVsync(false);
+	double contextMs = MeshCache::elapsedMs(phaseStart);
 
 	// Enable z-buffer
 	glEnable(GL_DEPTH_TEST);
@@ -85,175 +201,429 @@ int main(int argc, char *argv[])
 	// Avoid non-linear effects when sampling low resolution cube maps
 	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
-	std::string modelPath = argv[1];
-	std::string iblImagePath = argv[2];
+	if (GLExtensions::hasParallelShaderCompile())
+		GLExtensions::maxShaderCompilerThreads(Shader::parallelCompile ? 0xFFFFFFFF : 0);
+	if (Shader::parallelCompile)
+		Shader::preloadSources();
 
 	// CAUTION: always init buffers AFTER enabling GL_DEPTH_TEST
 
-	// Initialization of geometry + SSAO passes
-	initGeometryPass();
-	ScreenSpaceAO ssao(screenWidth, screenHeight);
+	phaseStart = std::chrono::steady_clock::now();
+	// Geometry + SSAO targets are allocated on the first frame
+	renderTargets = std::make_unique<RenderTargets>(screenWidth, screenHeight, gBufferLayout);
+	std::cout << "G-buffer: " << (gBufferLayout == RenderTargets::Layout::Compact ? "compact" : "classic")
+		<< " layout, " << renderTargets->getBytesPerPixel() << " bytes per pixel" << std::endl;
+	renderTargets->setScale(renderScale);
+	ScreenSpaceAO ssao(quality);
+
+	// Shaders initialization
+	// One geometry program per texture presence permutation, selected by each draw packet
+	ShaderPermutations geomShaders("geomVS.vert", "", "geomFS.frag", DrawPacket::featureKeys,
+		renderTargets->getDefines());
+	geomShaders.compileAll();
+	// Loaded models are drawn with multi-draw calls when possible, one per texture set (see
+	// DrawList::executeIndirect)
+	bool indirectGeometry = GLExtensions::hasMultiDrawIndirect();
+	std::unique_ptr<ShaderPermutations> geomIndirectShaders;
+	if (indirectGeometry)
+	{
+		geomIndirectShaders = std::make_unique<ShaderPermutations>("geomIndirectVS.vert", "", "geomIndirectFS.frag",
+			DrawPacket::featureKeys, renderTargets->getDefines());
+		geomIndirectShaders->compileAll();
+	}
+	ShaderPermutations &modelShaders = indirectGeometry ? *geomIndirectShaders : geomShaders;
+	// Untextured permutation, for the loading proxy
+	Shader &geomShader = geomShaders.get(0);
+	// Position-only programs of the depth pre-pass, matching each geometry path
+	std::unique_ptr<Shader> prepassShader;
+	if (prepassMode != DepthPrepass::Mode::Off)
+		prepassShader = indirectGeometry
+			? std::make_unique<Shader>("depthPrepassIndirectVS.vert", "", "depthPrepassFS.frag")
+			: std::make_unique<Shader>("depthPrepassVS.vert", "", "depthPrepassFS.frag");
+
+	// Every program is submitted before any of them is used, so that they compile concurrently
+	// Skybox
+	Shader environmentShader("environmentVS.vert", "", "environmentFS.frag");
+	// Screen space ambient occlusion
+	Shader::Defines ssaoDefines = ssao.getDefines();
+	for (const auto &define : renderTargets->getDefines())
+		ssaoDefines.push_back(define);
+	Shader ssaoShader("ssaoVS.vert", "", "ssaoFS.frag", ssaoDefines);
+	Shader ssaoBlurShader("ssaoVS.vert", "", "ssaoBlurFS.frag");
+	// Init light object (also rendered as cube)
+	Shader lightShader("lightVS.vert", "", "lightFS.frag");
+	// HDR rendering
+	Shader illumShader("illumVS.vert", "", "illumFS.frag", renderTargets->getDefines());
+	// Lit scene to the window, below full resolution only
+	Shader upscaleShader("ssaoVS.vert", "", "upscaleFS.frag");
+	Shader easuShader("ssaoVS.vert", "", "easuFS.frag");
+	Shader rcasShader("ssaoVS.vert", "", "rcasFS.frag");
+	Shader::releaseSources();
+
+	// Programs are only submitted here, compilation overlaps with what follows
+	double shadersMs = MeshCache::elapsedMs(phaseStart);
 
 	// Image-based lighting object
+	phaseStart = std::chrono::steady_clock::now();
 	std::string iblImagesDir = "Images/";
 	ImageBasedLighting ibl(iblImagesDir + iblImagePath, 5);
+	double iblMs = MeshCache::elapsedMs(phaseStart);
+	// Precomputations render at their own sizes
+	glViewport(0, 0, screenWidth, screenHeight);
 
-	// Shaders initialization
-	Shader geomShader("geomVS.vert", "", "geomFS.frag");
-	// Skybox
-	Shader environmentShader("environmentVS.vert", "", "environmentFS.frag");
 	environmentShader.use();
 	ibl.setEnvMapTextures(environmentShader);
-	// Screen space ambient occlusion
 	// CAUTION: verify texture names !!!
-	Shader ssaoShader("ssaoVS.vert", "", "ssaoFS.frag");
+	// The compact layout rebuilds positions from depth (see Shaders/GBufferRead.glsl)
+	const char *positionSampler = gBufferLayout == RenderTargets::Layout::Compact ? "depthTex" : "positionTex";
 	ssaoShader.use();
-	ssaoShader.setInt("positionTex", 29);
+	ssaoShader.setInt(positionSampler, 29);
 	ssaoShader.setInt("normalTex", 30);
 	ssaoShader.setInt("noiseTex", 10);
-	Shader ssaoBlurShader("ssaoVS.vert", "", "ssaoBlurFS.frag");
 	ssaoBlurShader.use();
 	ssaoBlurShader.setInt("ssaoTex", 0);
-	// Init light object (also rendered as cube)
-	Shader lightShader("lightVS.vert", "", "lightFS.frag");
-	// HDR rendering
-	Shader illumShader("illumVS.vert", "", "illumFS.frag");
 	illumShader.use();
-	illumShader.setInt("positionTex", 29);
+	illumShader.setInt(positionSampler, 29);
 	illumShader.setInt("normalTex", 30);
 	illumShader.setInt("colorSpecTex", 31);
 	illumShader.setInt("ssaoTex", 10);
 	ibl.setTextures(illumShader);
+	illumShader.setFloat("attenuation.kc", PointLight::attenuation.constant);
+	illumShader.setFloat("attenuation.kl", PointLight::attenuation.linear);
+	illumShader.setFloat("attenuation.kq", PointLight::attenuation.quadratic);
+	upscaleShader.use();
+	upscaleShader.setInt("sceneTex", 0);
+	easuShader.use();
+	easuShader.setInt("sceneTex", 0);
+	rcasShader.use();
+	rcasShader.setInt("upscaledTex", 0);
+	rcasShader.setFloat("sharpness", sharpness);
 
 	// Init camera object to navigate in the scene
 	camera = std::make_unique<Camera>();
 
-	objectModel = std::make_unique<Model>("Models/" + modelPath);
-	objectModel->setPosition(0.0f, 0.0f, 0.0f);
+	// Model files are read in the background, the scene is rendered meanwhile. Locals declared
+	// after the window, so that the model gives its buffers and textures back while the GL
+	// context and the shared pools and texture registry still exist, on every return path.
+	ModelLoader modelLoader;
+	std::shared_ptr<ModelLoader::Handle> objectModel = modelLoader.load("Models/" + modelPath);
+	int loadingPercent{-1};
+	// Keeps every measured frame of a benchmark
+	GpuProfiler gpuProfiler(std::max(240u, benchmarkMode ? maxFrames : 0u));
+	std::unique_ptr<Benchmark> benchmark;
+	if (benchmarkMode)
+	{
+		benchmark = std::make_unique<Benchmark>(gpuProfiler, maxFrames);
+		benchmark->addLoadTime("context", contextMs);
+		benchmark->addLoadTime("shaders", shadersMs);
+		benchmark->addLoadTime("ibl", iblMs);
+		benchmark->addSetting("renderScale",
+			frameBudgetMs > 0.0 ? "dynamic" : std::to_string((int)std::lround(renderScale * 100.0f)) + "%");
+		benchmark->addSetting("upscaler", edgeUpscaler ? "edge" : "bilinear");
+		benchmark->addSetting("gbuffer", gBufferLayout == RenderTargets::Layout::Compact ? "compact" : "classic");
+		benchmark->addSetting("depthPrepass", DepthPrepass::modeName(prepassMode));
+	}
+	DepthPrepass depthPrepass(prepassMode);
+	std::unique_ptr<DynamicResolution> dynamicResolution;
+	if (frameBudgetMs > 0.0)
+		dynamicResolution = std::make_unique<DynamicResolution>(frameBudgetMs);
+	uint64_t gpuFramesSeen{0};
+	float lastStatsTime{0.0f};
 
 	// Render loop
-	while (!glfwWindowShouldClose(window))
+	for (unsigned int frame = 0; !window->shouldClose(); frame++)
 	{
-		// Handle user input in a specific function
-		processInput(window);
-
-		glBindFramebuffer(GL_FRAMEBUFFER, gFrameBuffer);
-		glClearColor(0.0, 0.0, 0.0, 1.0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		geomShader.use();
-		camera->writeToShader(geomShader, screenWidth, screenHeight);
-		renderScene(geomShader);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		CPU_PROFILE_SCOPE("Frame");
+		// Handle user input in a specific function, benchmarks follow their camera path instead
+		if (benchmark)
+			cameraPath.apply(benchmark->getPathPosition(), *camera);
+		else
+			processInput(*window);
+
+		// Spread model uploads over frames to keep the loop responsive
+		modelLoader.update(4.0);
+		if (loadingPercent < 100)
+		{
+			int percent = objectModel->getProgress() * 100.0f;
+			if (objectModel->isReady())
+			{
+				objectModel->getModel().setPosition(0.0f, 0.0f, 0.0f);
+				window->setTitle("Hello OpenGL");
+				if (benchmark)
+				{
+					const ModelLoader::Handle::Timings &timings = objectModel->getTimings();
+					benchmark->addLoadTime("modelRead", timings.readMs);
+					benchmark->addLoadTime("modelDecode", timings.decodeMs);
+					benchmark->addLoadTime("modelUpload", timings.uploadMs);
+					glm::vec3 boundsMin, boundsMax;
+					if (cameraPath.empty() && objectModel->getBounds(boundsMin, boundsMax))
+						cameraPath = CameraPath::orbit(boundsMin, boundsMax);
+					cameraPath.apply(0.0f, *camera);
+				}
+			}
+			else if (objectModel->hasFailed())
+			{
+				window->setTitle("Hello OpenGL - failed to load model");
+				percent = 100;
+				if (benchmark)
+				{
+					std::cout << "ERROR::BENCHMARK::MODEL_NOT_LOADED " << objectModel->getPath() << std::endl;
+					return -1;
+				}
+			}
+			else if (percent != loadingPercent)
+			{
+				std::string title = "Hello OpenGL - loading " + objectModel->getPath() + " (" + std::to_string(percent) + "%)";
+				window->setTitle(title);
+			}
+			loadingPercent = objectModel->isReady() ? 100 : percent;
+		}
+
+		// Scale from the GPU time of the latest frame whose timings came back
+		if (dynamicResolution && gpuProfiler.getCollectedFrames() != gpuFramesSeen)
+		{
+			gpuFramesSeen = gpuProfiler.getCollectedFrames();
+			renderTargets->setScale(dynamicResolution->update(gpuProfiler.getLatest("Frame")));
+		}
+		// Offscreen passes render at the size of the targets, which lags behind window resizes
+		renderTargets->update();
+		unsigned int targetWidth = renderTargets->getWidth(), targetHeight = renderTargets->getHeight();
+
+		gpuProfiler.beginFrame();
+		{
+			CPU_PROFILE_SCOPE("Geometry");
+			GpuProfiler::Scope scope(gpuProfiler, "Geometry");
+			GLState::bindFramebuffer(GL_FRAMEBUFFER, renderTargets->getGBuffer());
+			glViewport(0, 0, targetWidth, targetHeight);
+			glClearColor(0.0, 0.0, 0.0, 1.0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			frameData.update(*camera, targetWidth, targetHeight,
+				benchmark ? benchmark->getSceneTime() : window->getTime());
+
+			geomShader.use();
+			drawList.clear();
+			renderScene(*objectModel, geomShader, modelShaders);
+			// Only the loaded model goes through the draw list, the loading proxy is already drawn
+			if (depthPrepass.beginFrame(objectModel->isReady()))
+			{
+				GpuProfiler::Scope scope(gpuProfiler, "Depth prepass");
+				depthPrepass.beginDepth();
+				if (indirectGeometry)
+					drawList.executeIndirectDepth(*prepassShader);
+				else
+					drawList.executeDepth(*prepassShader);
+				depthPrepass.beginShading();
+			}
+			if (indirectGeometry)
+				drawList.executeIndirect();
+			else
+				drawList.execute();
+			depthPrepass.endFrame();
+			GLState::bindFramebuffer(GL_FRAMEBUFFER, window->getFramebuffer());
+		}
 
 		// SSAO passes (computation + blur)
-		glBindFramebuffer(GL_FRAMEBUFFER, ssao.getFbo());
-		glClear(GL_COLOR_BUFFER_BIT);
-		ssaoShader.use();
-		ssao.setUniforms(ssaoShader, gPositionTex, gNormalTex);
-		camera->writeToShader(ssaoShader, screenWidth, screenHeight);
-		DrawUtils::renderQuad(quadVAO, quadVBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, ssao.getBlurFbo());
-		glClear(GL_COLOR_BUFFER_BIT);
-		ssaoBlurShader.use();
-		ssao.setBlurUniforms(ssaoBlurShader);
-		DrawUtils::renderQuad(quadVAO, quadVBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		{
+			CPU_PROFILE_SCOPE("SSAO");
+			GpuProfiler::Scope scope(gpuProfiler, "SSAO");
+			{
+				GpuProfiler::Scope scope(gpuProfiler, "Occlusion");
+				GLState::bindFramebuffer(GL_FRAMEBUFFER, renderTargets->getSsaoFbo());
+				glClear(GL_COLOR_BUFFER_BIT);
+				ssao.setUniforms(ssaoShader, renderTargets->getPositionSourceTex(), renderTargets->getNormalTex());
+				DrawUtils::renderQuad(quadVAO, quadVBO);
+			}
+			{
+				GpuProfiler::Scope scope(gpuProfiler, "Blur");
+				GLState::bindFramebuffer(GL_FRAMEBUFFER, renderTargets->getBlurFbo());
+				glClear(GL_COLOR_BUFFER_BIT);
+				ssaoBlurShader.use();
+				ssao.setBlurUniforms(ssaoBlurShader, renderTargets->getSsaoTex());
+				DrawUtils::renderQuad(quadVAO, quadVBO);
+				GLState::bindFramebuffer(GL_FRAMEBUFFER, window->getFramebuffer());
+			}
+		}
 
 		// Final illumination pass
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		illumShader.use();
-		glActiveTexture(GL_TEXTURE29);
-		glBindTexture(GL_TEXTURE_2D, gPositionTex);
-		glActiveTexture(GL_TEXTURE30);
-		glBindTexture(GL_TEXTURE_2D, gNormalTex);
-		glActiveTexture(GL_TEXTURE31);
-		glBindTexture(GL_TEXTURE_2D, gColorSpecTex);
-		glActiveTexture(GL_TEXTURE10);
-		glBindTexture(GL_TEXTURE_2D, ssao.getBlurOutputTexId());
-		glActiveTexture(GL_TEXTURE11);
-		ibl.setUniforms(illumShader);
-		camera->writeToShader(illumShader, screenWidth, screenHeight);
-		illumShader.setFloat("attenuation.kc", PointLight::attenuation.constant);
-		illumShader.setFloat("attenuation.kl", PointLight::attenuation.linear);
-		illumShader.setFloat("attenuation.kq", PointLight::attenuation.quadratic);
-		DrawUtils::renderQuad(quadVAO, quadVBO);
+		{
+			CPU_PROFILE_SCOPE("Illumination");
+			GpuProfiler::Scope scope(gpuProfiler, "Illumination");
+			// At full resolution, the scene is lit straight into the window
+			if (renderTargets->isScaled())
+			{
+				GLState::bindFramebuffer(GL_FRAMEBUFFER, renderTargets->getSceneFbo());
+				glViewport(0, 0, targetWidth, targetHeight);
+			}
+			else
+				glViewport(0, 0, screenWidth, screenHeight);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			illumShader.use();
+			GLState::bindTexture(29, GL_TEXTURE_2D, renderTargets->getPositionSourceTex());
+			GLState::bindTexture(30, GL_TEXTURE_2D, renderTargets->getNormalTex());
+			GLState::bindTexture(31, GL_TEXTURE_2D, renderTargets->getColorSpecTex());
+			GLState::bindTexture(10, GL_TEXTURE_2D, renderTargets->getBlurTex());
+			ibl.setUniforms(illumShader);
+			DrawUtils::renderQuad(quadVAO, quadVBO);
+		}
 
 		// Draw envmap image in the background
-		environmentShader.use();
-		camera->writeToShader(environmentShader, screenWidth, screenHeight);
-		ibl.setEnvMapUniforms(environmentShader);
-		DrawUtils::renderCube(cubeVAO, cubeVBO);
-
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("Skybox");
+			GpuProfiler::Scope scope(gpuProfiler, "Skybox");
+			environmentShader.use();
+			ibl.setEnvMapUniforms(environmentShader);
+			DrawUtils::renderCube(cubeVAO, cubeVBO);
+		}
+
+		if (renderTargets->isScaled())
+		{
+			CPU_PROFILE_SCOPE("Upscale");
+			GpuProfiler::Scope scope(gpuProfiler, "Upscale");
+			// The size of the upscale target, which lags behind window resizes like the others
+			glViewport(0, 0, renderTargets->getWindowWidth(), renderTargets->getWindowHeight());
+			if (edgeUpscaler)
+			{
+				// Edge-adaptive upscaling to the window size, then sharpening into the window
+				GLState::bindFramebuffer(GL_FRAMEBUFFER, renderTargets->getUpscaleFbo());
+				easuShader.use();
+				GLState::bindTexture(0, GL_TEXTURE_2D, renderTargets->getSceneTex());
+				DrawUtils::renderQuad(quadVAO, quadVBO);
+				GLState::bindFramebuffer(GL_FRAMEBUFFER, window->getFramebuffer());
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				rcasShader.use();
+				GLState::bindTexture(0, GL_TEXTURE_2D, renderTargets->getUpscaleTex());
+			}
+			else
+			{
+				GLState::bindFramebuffer(GL_FRAMEBUFFER, window->getFramebuffer());
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				upscaleShader.use();
+				GLState::bindTexture(0, GL_TEXTURE_2D, renderTargets->getSceneTex());
+			}
+			DrawUtils::renderQuad(quadVAO, quadVBO);
+		}
+		gpuProfiler.endFrame();
+
+		{
+			CPU_PROFILE_SCOPE("Swap buffers");
+			window->swapBuffers();
+		}
+		GLState::endFrame();
+		if (startupTime != std::chrono::steady_clock::time_point())
+		{
+			glFinish();
+			double firstFrameMs = MeshCache::elapsedMs(startupTime);
+			std::cout << "Time to first frame: " << firstFrameMs << " ms (parallel shader compilation "
+				<< (Shader::parallelCompile ? "on" : "off") << ")" << std::endl;
+			if (benchmark)
+				benchmark->addLoadTime("firstFrame", firstFrameMs);
+			// Every program has been used by now
+			Shader::printCacheStats();
+			startupTime = std::chrono::steady_clock::time_point();
+		}
 
 		// Per-frame timing
-		float curTime = glfwGetTime();
+		float curTime = window->getTime();
 		deltaTime = curTime - lastFrameTime;
 		lastFrameTime = curTime;
 
+		// State changes of the last geometry pass and GPU timings, refreshed every second
+		if (curTime - lastStatsTime > 1.0f)
+		{
+			if (objectModel->isReady())
+			{
+				const DrawList::Stats &stats = drawList.getStats();
+				const GLState::Stats &glStats = GLState::getFrameStats();
+				std::string title = "Hello OpenGL - " + std::to_string(stats.draws) + " draws in "
+					+ std::to_string(stats.calls) + " calls, "
+					+ std::to_string(stats.issued()) + " state changes, " + std::to_string(stats.elided()) + " elided, "
+					+ std::to_string(glStats.issued()) + " GL binds, " + std::to_string(glStats.elided()) + " elided";
+				if (dynamicResolution)
+					title += ", render scale " + std::to_string((int)std::lround(renderTargets->getScale() * 100.0f)) + "%";
+				if (depthPrepass.getMode() != DepthPrepass::Mode::Off)
+				{
+					char overdraw[16];
+					std::snprintf(overdraw, sizeof(overdraw), "%.2f", depthPrepass.getOverdraw());
+					title += std::string(", overdraw ") + overdraw + ", depth prepass "
+						+ (depthPrepass.isActive() ? "on" : "off");
+				}
+				window->setTitle(title);
+			}
+			if (showGpuTimings)
+				gpuProfiler.printReport();
+			lastStatsTime = curTime;
+		}
+
+		if (benchmark)
+			benchmark->endFrame(objectModel->isReady());
+		else if (!recordPathFile.empty())
+			cameraPath.record(*camera);
+
 		// Look for new interaction events
-		glfwPollEvents();
+		window->pollEvents();
+		if (benchmark ? benchmark->isDone() : maxFrames > 0 && frame + 1 >= maxFrames)
+			window->requestClose();
+	}
+
+	if (!gpuCsvPath.empty() && gpuProfiler.writeCsv(gpuCsvPath))
+		std::cout << "GPU timings written to " << gpuCsvPath << std::endl;
+	if (!cpuTracePath.empty())
+	{
+		if (CpuProfiler::enabled)
+			CpuProfiler::writeChromeTrace(cpuTracePath);
+		else
+			std::cout << "No CPU trace: build with -DCPU_PROFILER to record zones" << std::endl;
+	}
+	if (!recordPathFile.empty() && !benchmark && cameraPath.save(recordPathFile))
+		std::cout << "Camera path of " << cameraPath.size() << " frames written to " << recordPathFile << std::endl;
+	if (benchmark)
+	{
+		// Interrupted runs are not worth a report
+		if (!benchmark->isDone())
+			return -1;
+		if (!benchmark->writeJson(benchmarkOutPath, modelPath, iblImagePath, screenWidth, screenHeight))
+			return -1;
+		if (!baselinePath.empty() && !Benchmark::compare(benchmarkOutPath, baselinePath, regressionThreshold))
+			return 1;
 	}
 
-	// Clean GLFW variables data
-	glfwTerminate();
 	return 0;
 }
 
-void renderScene(Shader &shader)
+// The loading proxy is drawn right away with shader, models are queued with modelShaders
+void renderScene(ModelLoader::Handle &objectModel, Shader &shader, ShaderPermutations &modelShaders)
 {
-	shader.setMatrix4f("model", objectModel->getModelMat());
-	objectModel->draw(shader);
-}
+	if (objectModel.isReady())
+	{
+		objectModel.getModel().submit(drawList, modelShaders);
+		return;
+	}
 
-void initGeometryPass()
-{
-	// Init frame buffer for deferred shading
-	glGenFramebuffers(1, &gFrameBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, gFrameBuffer);
-
-	glGenTextures(1, &gPositionTex);
-	glBindTexture(GL_TEXTURE_2D, gPositionTex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, screenWidth, screenHeight, 0, GL_RGB, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, gPositionTex, 0);
-
-	glGenTextures(1, &gNormalTex);
-	glBindTexture(GL_TEXTURE_2D, gNormalTex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, screenWidth, screenHeight, 0, GL_RGB, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, gNormalTex, 0);
-
-	glGenTextures(1, &gColorSpecTex);
-	glBindTexture(GL_TEXTURE_2D, gColorSpecTex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screenWidth, screenHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, gColorSpecTex, 0);
-
-	GLenum frameBufferTextures[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
-	glDrawBuffers(3, frameBufferTextures);
-
-	glGenRenderbuffers(1, &gRenderBuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, gRenderBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, screenWidth, screenHeight);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, gRenderBuffer);
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer not complete ! " << std::endl;
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// Draw the bounding box of the model while it is still loading
+	glm::vec3 boundsMin, boundsMax;
+	if (!objectModel.getBounds(boundsMin, boundsMax))
+		return;
+	glm::mat4 proxyMat = glm::translate(glm::mat4(1.0f), 0.5f * (boundsMin + boundsMax));
+	proxyMat = glm::scale(proxyMat, 0.5f * (boundsMax - boundsMin));
+	shader.setMatrix4f("model", proxyMat);
+	shader.setVec3("material.diffuseColor", glm::vec3(0.5f));
+	shader.setFloat("material.shininess", 0.0f);
+	shader.setVec3("positionScale", glm::vec3(1.0f));
+	shader.setVec3("positionOffset", glm::vec3(0.0f));
+	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	DrawUtils::renderCube(cubeVAO, cubeVBO);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
-void framebuffer_size_callback(GLFWwindow *window, int width, int height)
+void framebuffer_size_callback(int width, int height)
 {
-	glViewport(0, 0, width, height);
+	// The viewport is set by each pass
+	screenWidth = width;
+	screenHeight = height;
+	renderTargets->requestResize(width, height);
 }
 
-void mouse_callback(GLFWwindow *window, double mouseX, double mouseY)
+void mouse_callback(double mouseX, double mouseY)
 {
 	if (firstMouse)
 	{
@@ -269,23 +639,30 @@ void mouse_callback(GLFWwindow *window, double mouseX, double mouseY)
 	lastY = mouseY;
 }
 
-void scroll_callback(GLFWwindow *window, double dx, double dy)
+void scroll_callback(double dy)
 {
 	camera->zoomFromScroll(dy);
 }
 
-void processInput(GLFWwindow *window)
+void key_callback(Window::Key key)
+{
+	if (key == Window::Key::P)
+		showGpuTimings = !showGpuTimings;
+}
+
+void processInput(Window &window)
 {
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-		glfwSetWindowShouldClose(window, true);
+	CPU_PROFILE_SCOPE("processInput");
+	if (window.isKeyDown(Window::Key::Escape))
+		window.requestClose();
 
 	const float camSpeed = 2.5f * deltaTime;
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+	if (window.isKeyDown(Window::Key::W))
 		camera->moveFromInput(deltaTime, 0.0f);
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+	if (window.isKeyDown(Window::Key::S))
 		camera->moveFromInput(-deltaTime, 0.0f);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+	if (window.isKeyDown(Window::Key::A))
 		camera->moveFromInput(0.0f, -deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+	if (window.isKeyDown(Window::Key::D))
 		camera->moveFromInput(0.0f, deltaTime);
 }